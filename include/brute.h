@@ -0,0 +1,24 @@
+/*
+ * Reference enumeration of candidate keys by testing every subset of
+ * attributes. Exponential in the number of attributes and meant only
+ * as an oracle for validating the other engines on small inputs.
+ */
+#pragma once
+#ifndef BRUTE_H
+#define BRUTE_H
+
+#include <stdint.h>
+
+#include "queue.h"
+#include "fd.h"
+
+// Largest number of attributes accepted by the brute-force engine
+#define BRUTE_MAX_ATTRIBS 20
+
+// Print all candidate keys of functional dependencies in q satisfying
+// constraints, in increasing order of attribute masks. Returns 0 on
+// success, nonzero if there are too many attributes.
+int8_t print_all_candidate_keys_brute(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c);
+
+#endif /* BRUTE_H */
@@ -0,0 +1,36 @@
+/*
+ * Key problems solved with a small CDCL SAT solver. Variable x_a states
+ * that attribute a belongs to the key. The super-key condition is added
+ * lazily as clauses: whenever an assignment is not a super-key, its
+ * closure is grown to a maximal closed set C and the clause "some
+ * attribute outside C is in the key" is learned. Attribute sets and
+ * FDs are kept as vectors of 64-bit words rather than Set, which only
+ * carries FDs in and keys out; schemas are therefore still limited to
+ * MAX_ATTRIBS attributes by the input format.
+ * 
+ */
+#pragma once
+#ifndef CDCL_H
+#define CDCL_H
+
+#include <stdint.h>
+
+#include "set.h"
+#include "queue.h"
+
+// Answer of queries if run was stopped before a decision
+#define CDCL_UNKNOWN 2
+
+// Print all candidate keys; every key found is excluded together with
+// its supersets by a blocking clause
+void print_all_candidate_keys_cdcl(const Queue *q, uint8_t n_attribs);
+// Check if there is a candidate key of at most k attributes and store
+// it in key (CDCL_UNKNOWN if stopped)
+uint8_t cdcl_has_key_of_size(const Queue *q, uint8_t n_attribs, uint8_t k,
+    Set *key);
+// Check if attribute is contained in some candidate key (prime) and
+// store witness key (CDCL_UNKNOWN if stopped)
+uint8_t cdcl_is_prime(const Queue *q, uint8_t n_attribs, uint8_t attrib,
+    Set *key);
+
+#endif /* CDCL_H */
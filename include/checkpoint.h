@@ -0,0 +1,30 @@
+/*
+ * Checkpoints of a Lucchesi-Osborn enumeration: FD set, candidate keys
+ * found so far and pending work items, stored as little endian 32 bit
+ * attribute masks with a checksum. Files are replaced atomically, so a
+ * crash leaves either the previous or the new checkpoint behind.
+ * 
+ */
+#pragma once
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "queue.h"
+
+typedef struct {
+    const char *path;    // file to write checkpoints to (NULL: none)
+    double interval;     // seconds between checkpoints
+    const char *resume;  // checkpoint to continue from (NULL: none)
+} checkpoint_config_t;
+
+// Write enumeration state to path; returns 0 on success
+int8_t checkpoint_write(const char *path, const Queue *q, uint8_t n_attribs,
+    const Queue *ckeys, const Queue *work);
+// Read enumeration state from path into (empty) queues ckeys and work,
+// checking that it belongs to FDs q; returns 0 on success
+int8_t checkpoint_read(const char *path, const Queue *q, uint8_t n_attribs,
+    Queue *ckeys, Queue *work);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,42 @@
+/*
+ * Run control shared by all enumeration engines: time and key limits,
+ * periodic progress reports on stderr and graceful stop on SIGINT or
+ * SIGTERM. Engines poll once per work item and report every key.
+ * 
+ */
+#pragma once
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+
+// Reasons for stopping an enumeration early
+#define STOP_NONE      0
+#define STOP_TIME      1
+#define STOP_KEYS      2
+#define STOP_SIGNAL    3
+
+// Start run with limits (0: none) and progress interval in seconds
+// (0: no progress reports)
+void control_init(double time_limit, uint64_t max_keys,
+    double progress_interval);
+// Stop gracefully on SIGINT/SIGTERM; a second signal terminates
+void control_install_signals(void);
+// Check limits and print progress if due; returns 1 if the engine
+// should stop. queue_depth is the amount of pending work.
+uint8_t control_poll(uint64_t queue_depth);
+// Count key before emitting it; returns 1 if it lies beyond the key
+// limit. The key is then dropped and the engine stops: the run found
+// more keys than allowed and is partial. A run with exactly as many
+// keys as the limit completes.
+uint8_t control_key_found(void);
+// Nanoseconds since run started
+uint64_t control_elapsed_ns(void);
+// Number of keys counted so far (at most the key limit)
+uint64_t control_keys_found(void);
+// Check if run was stopped (without polling clock)
+uint8_t control_stopped(void);
+// Print note marking output as partial if run was stopped
+void control_report(void);
+
+#endif /* CONTROL_H */
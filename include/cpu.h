@@ -0,0 +1,33 @@
+/*
+ * Runtime selection of instruction set variants for hot kernels. The
+ * binary targets baseline x86-64; functions marked with a dispatch
+ * attribute are additionally compiled for newer extensions and the
+ * loader picks the best variant once at startup via cpuid (GNU ifunc).
+ * On other targets or compilers the attributes expand to nothing.
+ */
+#pragma once
+#ifndef CPU_H
+#define CPU_H
+
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__linux__) && \
+    !defined(FD_NO_DISPATCH)
+#define CPU_DISPATCH 1
+// Bit counting: set sizes after set operations
+#define CPU_DISPATCH_POPCNT __attribute__((target_clones("popcnt", "default")))
+// Bit scanning: iteration over set elements
+#define CPU_DISPATCH_BMI __attribute__((target_clones("bmi", "default")))
+// Array scans over key masks
+#define CPU_DISPATCH_SIMD \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define CPU_DISPATCH 0
+#define CPU_DISPATCH_POPCNT
+#define CPU_DISPATCH_BMI
+#define CPU_DISPATCH_SIMD
+#endif
+
+// Names of instruction set extensions the running CPU offers to
+// dispatched kernels, e.g. "popcnt bmi avx2" ("baseline" if none)
+const char *cpu_features(void);
+
+#endif /* CPU_H */
@@ -0,0 +1,65 @@
+/*
+ * Closure and key primitives over a set of functional dependencies
+ * stored as queue of (lhs, rhs) attribute sets
+ * 
+ */
+#pragma once
+#ifndef FD_H
+#define FD_H
+
+#include <stdint.h>
+
+#include "set.h"
+#include "queue.h"
+
+// Compute closure of a set of attributes for given queues consisting
+// of attributes of left/right sides of all functional dependencies
+Set compute_closure(const Set *s, const Queue *q, uint8_t n_attribs);
+// Check if set of attributes s is a super-key given functional
+// dependencies in l -> r
+uint8_t is_superkey(const Set *s, const Queue *q, uint8_t n_attribs);
+// Reduce super-key to a candidate key by removing non-essential
+// attributes (in increasing order)
+Set candidate_key_from_super_key(Set *skey, const Queue *q, uint8_t n_attribs);
+
+
+// Outcome of propagating include/exclude decisions of a key search
+#define NODE_PRUNED 0  // no candidate key is consistent with decisions
+#define NODE_KEY    1  // included attributes form a candidate key
+#define NODE_OPEN   2  // branching on a free attribute is required
+
+// Propagate decisions of a search node for candidate keys containing
+// in and avoiding out: attributes implied by in are excluded, and
+// attributes without which no super-key remains are included
+uint8_t propagate_key_decisions(Set *in, Set *out, const Queue *q,
+    uint8_t n_attribs);
+// Closure of s under the FDs of a search, e.g. served from a cache;
+// arg is passed through unchanged
+typedef Set (*closure_fn)(const Set *s, void *arg);
+// As propagate_key_decisions, with all closures computed by closure
+uint8_t propagate_key_decisions_with(Set *in, Set *out, uint8_t n_attribs,
+    closure_fn closure, void *arg);
+// Lower bound on total weight (size if weights is NULL) of candidate
+// keys containing in and avoiding out; stores attribute to branch on
+uint64_t key_weight_lower_bound(const Set *in, const Set *out,
+    const Queue *q, uint8_t n_attribs, const uint32_t *weights,
+    uint8_t *branch);
+
+// Constraints on candidate keys enforced by search engines that work
+// on include/exclude decisions
+typedef struct {
+    Set include;       // attributes every key must contain
+    Set exclude;       // attributes no key may contain
+    uint8_t max_size;  // maximum number of attributes of a key
+} key_constraints_t;
+
+// Initialize constraints that admit every candidate key
+void key_constraints_init(key_constraints_t *c);
+// Check if constraints restrict family of candidate keys
+uint8_t key_constraints_active(const key_constraints_t *c);
+// Check if node of key search can still lead to a key satisfying the
+// size constraint (after propagation returned status)
+uint8_t key_constraints_admit(const key_constraints_t *c, const Set *in,
+    uint8_t status);
+
+#endif /* FD_H */
@@ -0,0 +1,113 @@
+/*
+ * libfuncdep: candidate key analysis of functional dependencies as a
+ * library for embedding in long-running processes. Functions return
+ * error codes instead of exiting and print nothing. Attribute sets are
+ * 32 bit masks with bit i for attribute 'A'+i, as in hex key output.
+ *
+ * An FD set is immutable once its FDs are added and may then be used
+ * by any number of threads at once. Key enumeration keeps its buffers
+ * in a workspace owned by the caller (one per thread); a workspace
+ * keeps its allocations between calls, so repeated enumerations of
+ * similar size do not allocate.
+ *
+ */
+#pragma once
+#ifndef FUNCDEP_H
+#define FUNCDEP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FUNCDEP_API __attribute__((visibility("default")))
+#else
+#define FUNCDEP_API
+#endif
+
+// Error codes
+#define FUNCDEP_OK          0
+#define FUNCDEP_ERR_ARG     1  // invalid argument, e.g. attribute count
+#define FUNCDEP_ERR_ATTRIB  2  // attribute outside of FD set
+#define FUNCDEP_ERR_PARSE   3  // malformed FD text
+#define FUNCDEP_ERR_IO      4  // file could not be read
+#define FUNCDEP_ERR_NOMEM   5  // allocation failed
+#define FUNCDEP_STOPPED     6  // enumeration stopped by callback
+#define FUNCDEP_DONE        7  // iterator has no more keys
+
+// Largest number of attributes
+#define FUNCDEP_MAX_ATTRIBS 26
+
+typedef struct funcdep funcdep_t;
+typedef struct funcdep_ws funcdep_ws_t;
+typedef struct funcdep_iter funcdep_iter_t;
+
+// Called for every candidate key found; nonzero return stops
+typedef int (*funcdep_key_cb)(uint32_t key, void *arg);
+
+// Description of error code
+FUNCDEP_API const char *funcdep_strerror(int8_t err);
+
+// Create empty FD set over n_attribs attributes
+FUNCDEP_API int8_t funcdep_create(uint8_t n_attribs, funcdep_t **out);
+// Add FD lhs -> rhs (both non-empty)
+FUNCDEP_API int8_t funcdep_add(funcdep_t *fd, uint32_t lhs, uint32_t rhs);
+// Create FD set from text in the input format of func_dep (attribute
+// count on first line, then one FD per line, e.g. "A, B -> C"); blank
+// lines are skipped. On parse errors, err_line (if not NULL) receives
+// the 1-based line number.
+FUNCDEP_API int8_t funcdep_parse(const char *text, funcdep_t **out,
+    uint32_t *err_line);
+// Create FD set from file in the input format of func_dep
+FUNCDEP_API int8_t funcdep_load(const char *path, funcdep_t **out,
+    uint32_t *err_line);
+FUNCDEP_API void funcdep_free(funcdep_t *fd);
+FUNCDEP_API uint8_t funcdep_n_attribs(const funcdep_t *fd);
+FUNCDEP_API uint32_t funcdep_n_fds(const funcdep_t *fd);
+// FD number i (in insertion order)
+FUNCDEP_API int8_t funcdep_get(const funcdep_t *fd, uint32_t i,
+    uint32_t *lhs, uint32_t *rhs);
+
+// Closure of attributes under FDs
+FUNCDEP_API int8_t funcdep_closure(const funcdep_t *fd, uint32_t attribs,
+    uint32_t *closure);
+// Check if attributes determine all attributes
+FUNCDEP_API int8_t funcdep_is_superkey(const funcdep_t *fd, uint32_t attribs,
+    uint8_t *result);
+// Reduce super-key to a candidate key contained in it
+FUNCDEP_API int8_t funcdep_minimize(const funcdep_t *fd, uint32_t superkey,
+    uint32_t *key);
+
+// Workspace for key enumeration, reused across calls
+FUNCDEP_API int8_t funcdep_ws_create(funcdep_ws_t **out);
+FUNCDEP_API void funcdep_ws_free(funcdep_ws_t *ws);
+// Enumerate all candidate keys (Lucchesi-Osborn) and pass each to cb.
+// n_keys (if not NULL) receives the number of keys passed to cb.
+// Returns FUNCDEP_STOPPED if cb asked to stop.
+FUNCDEP_API int8_t funcdep_keys(const funcdep_t *fd, funcdep_ws_t *ws,
+    funcdep_key_cb cb, void *arg, uint64_t *n_keys);
+
+// Pull-based enumeration: every call of funcdep_iter_next does only
+// the work needed to find one more key (Lucchesi-Osborn order, as
+// funcdep_keys), so callers pay for the keys they take and may stop
+// or interleave other work at any time. The FD set must outlive the
+// iterator; an iterator is used by one thread at a time.
+FUNCDEP_API int8_t funcdep_iter_create(const funcdep_t *fd,
+    funcdep_iter_t **out);
+// Restart from the first key, for fd or another FD set, keeping the
+// buffers of the iterator
+FUNCDEP_API int8_t funcdep_iter_reset(funcdep_iter_t *it, const funcdep_t *fd);
+// Store next key; returns FUNCDEP_DONE once all keys were returned.
+// After other errors the iterator can only be reset or freed.
+FUNCDEP_API int8_t funcdep_iter_next(funcdep_iter_t *it, uint32_t *key);
+// Number of keys returned so far
+FUNCDEP_API uint64_t funcdep_iter_count(const funcdep_iter_t *it);
+FUNCDEP_API void funcdep_iter_free(funcdep_iter_t *it);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FUNCDEP_H */
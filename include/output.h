@@ -0,0 +1,38 @@
+/*
+ * Buffered output of candidate keys. Keys are formatted into large
+ * batches which are written by the calling thread or, optionally, by a
+ * dedicated writer thread while enumeration goes on. The first key is
+ * written at once, later batches at least every 50 ms while keys keep
+ * coming. Keys must be emitted from one thread at a time.
+ * 
+ */
+#pragma once
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+
+#include "set.h"
+
+// Key formats
+#define OUTPUT_TEXT     0  // attribute letters separated by spaces
+#define OUTPUT_NDJSON   1  // {"key":["A","B"]} per line
+#define OUTPUT_CSV      2  // attribute letters separated by commas
+#define OUTPUT_HEX      3  // attribute bitmask, bit i for attribute i
+#define OUTPUT_BINARY   4  // little endian 32 bit bitmask per key
+#define OUTPUT_INVALID  5
+
+// Look up format by name; returns OUTPUT_INVALID if unknown
+uint8_t output_format(const char *name);
+// Direct keys to file at path (NULL: stdout) in given format. Keys in
+// formats other than text written to stdout get stdout for themselves;
+// all other output is moved to stderr. Returns 0 on success.
+int8_t output_init(uint8_t format, const char *path, uint8_t threaded);
+// Append key to output (and result file if one is written)
+void output_key(const Set *key);
+// Write all pending keys (wait for writer thread)
+void output_flush(void);
+// Flush and release output; stops writer thread
+void output_close(void);
+
+#endif /* OUTPUT_H */
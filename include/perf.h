@@ -0,0 +1,60 @@
+/*
+ * Optional hardware performance counters (Linux perf_event_open):
+ * cycles, instructions, cache misses and branch misses per phase of
+ * the run and for hot regions (closure computation, scans of found
+ * keys). Regions are counted per thread by reading a counter group on
+ * entry and exit, which costs two system calls per region. If counters
+ * cannot be opened, a note is printed and the run continues without.
+ * 
+ */
+#pragma once
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+#define PERF_CYCLES         0
+#define PERF_INSTRUCTIONS   1
+#define PERF_CACHE_MISSES   2
+#define PERF_BRANCH_MISSES  3
+#define PERF_N_EVENTS       4
+
+#define PERF_REGION_CLOSURE 0  // compute_closure and is_superkey
+#define PERF_REGION_SCAN    1  // containment checks against found keys
+#define PERF_N_REGIONS      2
+
+extern uint8_t perf_enabled;
+
+// Open counters for phases; returns 0 if hardware counters are usable
+int8_t perf_init(void);
+// Accumulate counts of phase (see stats.h) between begin and end
+void perf_phase_begin(uint8_t phase);
+void perf_phase_end(uint8_t phase);
+// Accumulate counts of calling thread inside region
+void perf_region_enter(uint8_t region);
+void perf_region_leave(uint8_t region);
+// Library builds (FUNCDEP_LIB) count no regions
+static inline void perf_region_begin(uint8_t region) {
+#ifdef FUNCDEP_LIB
+    (void) region;
+#else
+    if (perf_enabled) {
+        perf_region_enter(region);
+    }
+#endif
+}
+static inline void perf_region_end(uint8_t region) {
+#ifdef FUNCDEP_LIB
+    (void) region;
+#else
+    if (perf_enabled) {
+        perf_region_leave(region);
+    }
+#endif
+}
+// Add region counts of calling thread to totals (call before it exits)
+void perf_merge_thread(void);
+// Print counts, IPC and misses per phase and region on stderr
+void perf_report(void);
+
+#endif /* PERF_H */
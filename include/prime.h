@@ -0,0 +1,26 @@
+/*
+ * Prime attributes (attributes contained in at least one candidate
+ * key) computed without enumerating all candidate keys. Each attribute
+ * is decided by a pruned search for a single witness key containing
+ * it; attributes are distributed among threads sharing one closure
+ * cache.
+ * 
+ */
+#pragma once
+#ifndef PRIME_H
+#define PRIME_H
+
+#include <stdint.h>
+
+#include "set.h"
+#include "queue.h"
+
+// Determine prime attributes; stores witness key for each prime
+// attribute in witness (empty set for non-prime attributes) and the
+// attributes decided in decided (all unless the run was stopped)
+Set compute_prime_attribs(const Queue *q, uint8_t n_attribs, uint32_t n_threads,
+    Set witness[MAX_ATTRIBS], uint32_t *decided);
+// Print prime attributes together with witness keys
+void print_prime_attribs(const Queue *q, uint8_t n_attribs, uint32_t n_threads);
+
+#endif /* PRIME_H */
@@ -0,0 +1,22 @@
+/*
+ * Parallel candidate key enumeration over a search tree of attribute
+ * decisions. Every candidate key has exactly one parent path in the
+ * tree, so subtrees can be explored independently without sharing
+ * the list of keys found so far. Workers write keys as they find them.
+ * 
+ */
+#pragma once
+#ifndef REVERSE_H
+#define REVERSE_H
+
+#include <stdint.h>
+
+#include "queue.h"
+#include "fd.h"
+
+// Print all candidate keys of functional dependencies in q satisfying
+// constraints, splitting the search tree among n_threads workers
+void print_all_candidate_keys_reverse(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c, uint32_t n_threads);
+
+#endif /* REVERSE_H */
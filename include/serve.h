@@ -0,0 +1,26 @@
+/*
+ * Analysis daemon: func_dep serve listens on a Unix domain socket and
+ * keeps named FD sets resident, together with their closure caches,
+ * candidate keys and normal form once computed. Clients send one
+ * request per line and get one response line:
+ * - LOAD <name> <file>        parse file into FD set name (replaces it)
+ * - PUT <name> <n>;<FD>;...   FD set from inline text, e.g. 3;A->B;B->C
+ * - DROP <name>               forget FD set
+ * - CLOSURE <name> <attrs>    closure of attributes, e.g. AB or A,B
+ * - SUPERKEY <name> <attrs>   1 if attributes are a super-key, else 0
+ * - KEYS <name> [<limit>]     key count and (at most limit) keys
+ * - NF <name>                 highest of 1NF, 2NF, 3NF and BCNF, with an
+ *                             FD violating the next one
+ * - LIST, STATS, QUIT
+ * Responses start with OK or ERR. Sets are printed as attribute letters,
+ * the empty set as '-'. Every connection is served by its own thread.
+ *
+ */
+#pragma once
+#ifndef SERVE_H
+#define SERVE_H
+
+// Run daemon; returns exit status once stopped by SIGINT/SIGTERM
+int serve_main(int argc, char *argv[], const char *prog);
+
+#endif /* SERVE_H */
@@ -0,0 +1,84 @@
+/*
+ * Out-of-core Lucchesi-Osborn enumeration within a memory budget. The
+ * work FIFO keeps only its two ends in RAM and spills the middle to
+ * sequential segment files. Found keys are partitioned by size; each
+ * partition buffers recent keys in RAM and flushes them as sorted runs
+ * on disk, summarized in RAM by the attributes common to all keys of
+ * the run. Keys are stored as 32 bit attribute masks.
+ *
+ */
+#pragma once
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdint.h>
+
+#include "queue.h"
+#include "set.h"
+
+// FIFO of key masks with RAM-resident ends and segments on disk
+typedef struct {
+    const char *dir;
+    uint32_t *head;       // newest masks, appended here
+    uint32_t head_len;
+    uint32_t *tail;       // oldest masks, popped from here
+    uint32_t tail_len;
+    uint32_t tail_pos;
+    uint32_t seg_cap;     // masks per buffer and segment
+    uint64_t seg_first;   // segments on disk are [seg_first, seg_next)
+    uint64_t seg_next;
+    uint64_t size;
+} spill_queue_t;
+
+// Sorted run of keys on disk (file already unlinked)
+typedef struct {
+    int fd;
+    uint32_t count;
+    uint32_t common;      // attributes contained in every key of run
+} ks_run_t;
+
+// Keys of one size: RAM buffer plus runs on disk
+typedef struct {
+    uint32_t *keys;
+    uint32_t len;
+    uint32_t cap;
+    ks_run_t *runs;
+    uint32_t n_runs;
+} ks_partition_t;
+
+// Set of found keys supporting "contains any key" queries
+typedef struct {
+    const char *dir;
+    uint64_t next_run;
+    ks_partition_t part[MAX_ATTRIBS+1];
+    uint32_t ram_len;     // keys buffered in RAM over all partitions
+    uint32_t ram_cap;
+    uint32_t *io_buf;     // buffer for streaming runs
+    uint32_t io_cap;
+    uint64_t size;
+    uint64_t runs_read;   // runs scanned by containment checks
+} key_store_t;
+
+void SQ_init(spill_queue_t *sq, const char *dir, uint32_t seg_cap);
+void SQ_push(spill_queue_t *sq, uint32_t mask);
+uint32_t SQ_pop(spill_queue_t *sq);
+void SQ_free(spill_queue_t *sq);
+
+void KS_init(key_store_t *ks, const char *dir, uint32_t ram_cap,
+    uint32_t io_cap);
+void KS_insert(key_store_t *ks, uint32_t mask);
+// Check if any stored key is a subset of mask
+uint8_t KS_contains_subset(key_store_t *ks, uint32_t mask);
+void KS_free(key_store_t *ks);
+
+// Default smallest buffers (in masks) used regardless of memory budget
+#define SPILL_MIN_BUFFER 1024u
+
+// Print all candidate keys of functional dependencies in q using about
+// memory_budget bytes for work queue and keys, but buffers of at least
+// min_buffer masks, spilling to files in a private directory below
+// spill_dir; returns 0 on success
+int8_t print_all_candidate_keys_spill(const Queue *q, uint8_t n_attribs,
+    uint64_t memory_budget, uint32_t min_buffer, const char *spill_dir);
+
+#endif /* SPILL_H */
@@ -0,0 +1,101 @@
+/*
+ * Run statistics: wall and CPU time per phase and counters of hot-path
+ * operations. Counters are thread-local plain increments that worker
+ * threads merge once when they finish, so they stay enabled always;
+ * --stats only decides whether they are reported. Memory is accounted
+ * per kind of data structure (live, peak and allocation count) and
+ * reported with the peak resident set size. Key latency is recorded as
+ * time to first key and a log-linear histogram of gaps between keys.
+ * Library builds (FUNCDEP_LIB) compile the hot-path hooks out.
+ * 
+ */
+#pragma once
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// Phases of a run
+#define STATS_PARSE       0
+#define STATS_PREPROCESS  1
+#define STATS_ENUMERATE   2
+#define STATS_OUTPUT      3
+#define STATS_N_PHASES    4
+
+typedef struct {
+    uint64_t closure_calls;       // compute_closure and is_superkey
+    uint64_t fd_scans;            // FDs visited while computing closures
+    uint64_t superkey_tests;      // is_superkey
+    uint64_t containment_checks;  // found keys tested for S containing them
+    uint64_t s_generated;         // sets S built from key and FD
+    uint64_t s_rejected;          // sets S containing a found key
+    uint64_t peak_queue;          // largest amount of pending work
+} stats_counters_t;
+
+extern _Thread_local stats_counters_t stats_local;
+
+#ifdef FUNCDEP_LIB
+#define STATS_ADD(field, n) ((void)(n))
+#else
+#define STATS_ADD(field, n) (stats_local.field += (uint64_t)(n))
+#endif
+
+const char *stats_phase_name(uint8_t phase);
+// Start/stop timing phase; time of repeated intervals adds up. A phase
+// begun inside another one (output during enumeration) pauses it.
+void stats_phase_begin(uint8_t phase);
+void stats_phase_end(uint8_t phase);
+// Record amount of pending work
+static inline void stats_queue_depth(uint64_t depth) {
+#ifdef FUNCDEP_LIB
+    (void) depth;
+#else
+    if (depth > stats_local.peak_queue) {
+        stats_local.peak_queue = depth;
+    }
+#endif
+}
+// Kinds of memory accounted by stats_alloc/stats_free
+#define MEM_QUEUE    0  // Queue nodes (FDs, work lists, found keys)
+#define MEM_KEYS     1  // key store and work buffers of spill mode, store
+#define MEM_SEARCH   2  // node pools and heaps of tree searches
+#define MEM_ZDD      3  // ZDD node tables and caches
+#define MEM_SOLVER   4  // CDCL clauses, watch lists and variable data
+#define MEM_N_KINDS  5
+
+// Record allocation or release of bytes of kind. Live bytes are shared
+// by all threads, so these are atomic and meant for allocations, not
+// for hot loops without them. A resize counts as one allocation.
+#ifdef FUNCDEP_LIB
+static inline void stats_alloc(uint8_t kind, uint64_t bytes) {
+    (void) kind;
+    (void) bytes;
+}
+static inline void stats_free(uint8_t kind, uint64_t bytes) {
+    (void) kind;
+    (void) bytes;
+}
+static inline void stats_resize(uint8_t kind, uint64_t old_bytes,
+    uint64_t new_bytes) {
+    (void) kind;
+    (void) old_bytes;
+    (void) new_bytes;
+}
+#else
+void stats_alloc(uint8_t kind, uint64_t bytes);
+void stats_free(uint8_t kind, uint64_t bytes);
+void stats_resize(uint8_t kind, uint64_t old_bytes, uint64_t new_bytes);
+#endif
+// Set by --stats; key latency is only measured then
+extern uint8_t stats_enabled;
+// Record that n keys reached their file ns nanoseconds after
+// enumeration started (one write of a batch)
+void stats_keys_emitted(uint64_t n, uint64_t ns);
+// Add counters of calling thread (including hardware counters of its
+// regions) to totals (call before thread exits)
+void stats_merge_thread(void);
+// Print phase times, counter totals, key latency and memory use on
+// stderr
+void stats_report(void);
+
+#endif /* STATS_H */
@@ -0,0 +1,57 @@
+/*
+ * Result file of an enumeration that can be memory-mapped and queried
+ * without recomputation. Layout (native byte order):
+ * - header: magic "FDKEYS01", attribute count, key count, offsets
+ * - key i as 32 bit attribute mask at index i
+ * - per attribute a posting bitmap of 64 bit words; bit i is set if
+ *   key i contains the attribute
+ * 
+ */
+#pragma once
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "set.h"
+
+typedef struct {
+    char magic[8];
+    uint32_t n_attribs;
+    uint32_t reserved;
+    uint64_t n_keys;
+    uint64_t masks_offset;     // offset of key masks
+    uint64_t postings_offset;  // offset of first posting bitmap
+    uint64_t posting_words;    // 64 bit words per posting bitmap
+} store_header_t;
+
+// Mapped result file
+typedef struct {
+    void *base;
+    size_t length;
+    const store_header_t *header;
+    const uint32_t *masks;
+    const uint64_t *postings;
+} store_t;
+
+// Writing: keys are collected and the file is written on close. Keys
+// arrive through output_key only, so every mode writing a result file
+// must emit its keys there (func_dep refuses -S for the report-only
+// modes -a, -k and -p).
+// Start collecting keys for file at path
+void store_begin(const char *path, uint8_t n_attribs);
+// Add key (no-op unless collecting)
+void store_add(uint32_t mask);
+// Write collected keys atomically; returns 0 on success
+int8_t store_end(void);
+
+// Reading: map file at path; returns 0 on success
+int8_t store_map(store_t *st, const char *path);
+void store_unmap(store_t *st);
+// Posting bitmap of attribute
+static inline const uint64_t *store_posting(const store_t *st, uint8_t attrib) {
+    return st->postings + (size_t) attrib * st->header->posting_words;
+}
+
+#endif /* STORE_H */
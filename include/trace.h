@@ -0,0 +1,49 @@
+/*
+ * Timeline tracing of a run as Chrome trace event JSON (viewable in
+ * chrome://tracing or Perfetto). Every thread appends complete spans to
+ * its own buffer without locking; buffers are linked into a global list
+ * once per thread and written out when the run ends. Span names must be
+ * string literals.
+ * 
+ */
+#pragma once
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Work items of an enumeration loop recorded as one span
+#define TRACE_BATCH 64u
+
+extern uint8_t trace_enabled;
+
+// Enable tracing; spans are written to path by trace_write
+void trace_init(const char *path);
+// Nanoseconds on monotonic clock
+uint64_t trace_now(void);
+// Append span from start (as returned by trace_start) to now
+void trace_record(const char *name, uint64_t start);
+// Write all spans as JSON; returns 0 on success
+int8_t trace_write(void);
+
+// Library builds (FUNCDEP_LIB) record no spans
+#ifdef FUNCDEP_LIB
+static inline uint64_t trace_start(void) {
+    return 0;
+}
+static inline void trace_end(const char *name, uint64_t start) {
+    (void) name;
+    (void) start;
+}
+#else
+static inline uint64_t trace_start(void) {
+    return trace_enabled ? trace_now() : 0;
+}
+static inline void trace_end(const char *name, uint64_t start) {
+    if (trace_enabled) {
+        trace_record(name, start);
+    }
+}
+#endif
+
+#endif /* TRACE_H */
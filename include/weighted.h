@@ -0,0 +1,34 @@
+/*
+ * Candidate keys of minimum total attribute weight (e.g. byte width)
+ * found by branch-and-bound over include/exclude decisions, with
+ * lower bounds derived from disjoint cuts of maximal closed sets.
+ * Ranked enumeration expands nodes best-first by a lower bound on key
+ * size, so keys are emitted in nondecreasing cardinality.
+ * 
+ */
+#pragma once
+#ifndef WEIGHTED_H
+#define WEIGHTED_H
+
+#include <stdint.h>
+
+#include "set.h"
+#include "queue.h"
+#include "fd.h"
+
+// Find up to k candidate keys satisfying constraints of least total
+// weight; stores them in nondecreasing order of weight and returns
+// number of keys found
+uint32_t min_weight_keys(const Queue *q, uint8_t n_attribs,
+    const uint32_t weights[MAX_ATTRIBS], const key_constraints_t *c, uint32_t k,
+    Set *keys, uint64_t *costs);
+// Print up to k candidate keys satisfying constraints of least total
+// weight
+void print_min_weight_keys(const Queue *q, uint8_t n_attribs,
+    const uint32_t weights[MAX_ATTRIBS], const key_constraints_t *c, uint32_t k);
+// Print candidate keys satisfying constraints in nondecreasing size;
+// stops after max_keys keys (0: no limit)
+void print_keys_ranked(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c, uint32_t max_keys);
+
+#endif /* WEIGHTED_H */
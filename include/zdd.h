@@ -0,0 +1,88 @@
+/*
+ * Zero-suppressed decision diagrams (ZDDs) for families of attribute
+ * sets. Nodes are hash-consed in a unique table, so equal families
+ * share one node id. Variables are attribute indices in increasing
+ * order from the root.
+ * 
+ */
+#pragma once
+#ifndef ZDD_H
+#define ZDD_H
+
+#include <stdint.h>
+
+#include "set.h"
+#include "queue.h"
+
+// Terminal nodes
+#define ZDD_EMPTY 0u  // empty family
+#define ZDD_BASE  1u  // family containing only the empty set
+
+typedef uint32_t zdd_t;
+
+typedef struct {
+    uint8_t var;
+    zdd_t lo;  // sets without var
+    zdd_t hi;  // sets with var (var removed)
+} zdd_node_t;
+
+typedef struct {
+    uint32_t op;
+    uint32_t a;
+    uint32_t b;
+    zdd_t result;
+} zdd_cache_entry_t;
+
+// ZDD manager holding all nodes
+typedef struct {
+    zdd_node_t *nodes;
+    uint64_t *counts;        // memoized family sizes, UINT64_MAX if unknown
+    uint32_t size;
+    uint32_t capacity;
+    zdd_t *unique;           // open addressing table of node ids
+    uint32_t unique_mask;
+    zdd_cache_entry_t *cache;  // direct-mapped operation cache
+    uint32_t cache_mask;
+} Zdd;
+
+// Iterator over all sets of a family, one set per call
+typedef struct {
+    const Zdd *z;
+    zdd_t path[MAX_ATTRIBS + 1];
+    uint8_t took_hi[MAX_ATTRIBS + 1];
+    uint8_t depth;
+    uint8_t started;
+    uint32_t current;
+    zdd_t root;
+} Zdd_iterator;
+
+// Initialize/free ZDD manager
+void Zdd_init(Zdd *z);
+void Zdd_free(Zdd *z);
+
+// Family containing exactly the set s
+zdd_t Zdd_singleton(Zdd *z, const Set *s);
+// Union of two families
+zdd_t Zdd_union(Zdd *z, zdd_t f, zdd_t g);
+// Sets of f containing attribute i
+zdd_t Zdd_onset(Zdd *z, zdd_t f, uint8_t i);
+// All supersets over n_attribs attributes of sets in f
+zdd_t Zdd_supersets(Zdd *z, zdd_t f, uint8_t n_attribs);
+
+// Number of sets in family
+uint64_t Zdd_count(Zdd *z, zdd_t f);
+// Check if set s is a member of family
+uint8_t Zdd_contains(const Zdd *z, zdd_t f, const Set *s);
+// Check if family has some member that is a subset of s
+uint8_t Zdd_has_subset(Zdd *z, zdd_t f, const Set *s);
+
+// Lazily enumerate members of family
+void Zdd_iterator_init(Zdd_iterator *it, const Zdd *z, zdd_t f);
+// Store next member in s; returns 0 once all members were visited
+uint8_t Zdd_iterator_next(Zdd_iterator *it, Set *s);
+
+// From paper: Candidate Keys for Relations (Lucchesi and Osborn), with
+// the list of found candidate keys replaced by a ZDD
+zdd_t Zdd_candidate_keys(Zdd *z, const Queue *q, uint8_t n_attribs);
+
+#endif /* ZDD_H */
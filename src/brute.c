@@ -0,0 +1,72 @@
+#include "brute.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "output.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Masks tested between polls of run control
+#define BRUTE_POLL_INTERVAL 4096u
+
+static Set set_from_mask(uint32_t mask) {
+    Set s;
+    Set_init(&s);
+    s.set = mask;
+    s.size = (uint8_t) __builtin_popcount(mask);
+    return s;
+}
+
+// Candidate key: super-key without any super-key one attribute smaller
+// (super-keys are closed under supersets)
+static uint8_t is_candidate_key(uint32_t mask, const Queue *q,
+    uint8_t n_attribs) {
+    
+    Set s = set_from_mask(mask);
+    if (!is_superkey(&s, q, n_attribs)) {
+        return 0;
+    }
+    uint32_t bits = mask;
+    while (bits) {
+        s = set_from_mask(mask & ~(bits & -bits));
+        if (is_superkey(&s, q, n_attribs)) {
+            return 0;
+        }
+        bits &= bits - 1;
+    }
+    return 1;
+}
+
+int8_t print_all_candidate_keys_brute(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c) {
+    
+    if (n_attribs > BRUTE_MAX_ATTRIBS) {
+        fprintf(stderr, "Brute-force engine supports at most %u attributes\n",
+            BRUTE_MAX_ATTRIBS);
+        return 1;
+    }
+    const uint32_t end = 1u << n_attribs;
+    uint32_t mask, n_keys = 0;
+    for (mask = 0; mask < end; ++mask) {
+        if (mask % BRUTE_POLL_INTERVAL == 0 && control_poll(end - mask)) {
+            break;
+        }
+        if ((mask & c->include.set) != c->include.set ||
+            (mask & c->exclude.set) ||
+            (uint32_t) __builtin_popcount(mask) > c->max_size ||
+            !is_candidate_key(mask, q, n_attribs)) {
+            continue;
+        }
+        if (control_key_found()) {
+            break;
+        }
+        const Set key = set_from_mask(mask);
+        output_key(&key);
+        ++n_keys;
+    }
+    output_flush();
+    printf("Number of candidate keys: %u\n", n_keys);
+    return 0;
+}
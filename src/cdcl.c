@@ -0,0 +1,912 @@
+#include "cdcl.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "output.h"
+#include "stats.h"
+#include "perf.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// Literals: 2 * var for positive, 2 * var + 1 for negated variable
+#define LIT(v, neg) (2u * (v) + (neg))
+#define VAR(l) ((l) >> 1)
+#define NEG(l) ((l) ^ 1u)
+
+#define VAL_FALSE 0
+#define VAL_TRUE  1
+#define VAL_UNDEF 2
+
+#define RESTART_BASE 64
+#define VAR_DECAY 0.95
+#define CLA_DECAY 0.999
+
+typedef struct {
+    uint32_t size;
+    uint8_t learnt;
+    double activity;
+    uint32_t lits[];
+} clause_t;
+
+typedef struct {
+    clause_t **data;
+    uint32_t size;
+    uint32_t capacity;
+} clause_vec_t;
+
+typedef struct solver_t solver_t;
+
+// Called on every total assignment. Returns 1 to accept the model or 0
+// after adding a clause falsified by the assignment
+typedef uint8_t (*theory_check_t)(solver_t *s, void *arg);
+
+struct solver_t {
+    uint32_t n_vars;
+    uint8_t *assigns;
+    uint32_t *level;
+    clause_t **reason;
+    double *activity;
+    uint8_t *seen;
+    uint32_t *trail;
+    uint32_t trail_size;
+    uint32_t *trail_lim;
+    uint32_t n_levels;
+    uint32_t qhead;
+    clause_vec_t *watches;  // indexed by literal
+    clause_vec_t clauses;
+    clause_vec_t learnts;
+    uint32_t max_learnts;
+    double var_inc;
+    double cla_inc;
+    uint8_t unsat;
+    clause_t *pending;      // falsified clause added by theory
+    uint32_t *buf;
+    theory_check_t check;
+    void *arg;
+};
+
+static uint64_t clause_bytes(uint32_t size) {
+    return sizeof(clause_t) + size * sizeof(uint32_t);
+}
+
+static void clause_free(clause_t *c) {
+    stats_free(MEM_SOLVER, clause_bytes(c->size));
+    free(c);
+}
+
+// Bytes of per-variable arrays of solver
+static uint64_t solver_array_bytes(uint32_t n_vars) {
+    return n_vars * (1 + sizeof(uint32_t) + sizeof(clause_t *) +
+                     sizeof(double) + 1 + sizeof(uint32_t)) +
+           2 * (n_vars + 1) * sizeof(uint32_t) +
+           2 * n_vars * sizeof(clause_vec_t);
+}
+
+static void vec_push(clause_vec_t *v, clause_t *c) {
+    if (v->size == v->capacity) {
+        stats_resize(MEM_SOLVER, v->capacity * sizeof(clause_t *),
+            (v->capacity ? 2 * v->capacity : 4) * sizeof(clause_t *));
+        v->capacity = v->capacity ? 2 * v->capacity : 4;
+        v->data = (clause_t **) realloc(v->data, v->capacity * sizeof(clause_t *));
+        assert(v->data != NULL);
+    }
+    v->data[v->size++] = c;
+}
+
+static uint8_t lit_value(const solver_t *s, uint32_t l) {
+    const uint8_t a = s->assigns[VAR(l)];
+    return a == VAL_UNDEF ? VAL_UNDEF : (uint8_t)(a ^ (l & 1u));
+}
+
+static void solver_init(solver_t *s, uint32_t n_vars, theory_check_t check,
+    void *arg) {
+    
+    memset(s, 0, sizeof(solver_t));
+    s->n_vars = n_vars;
+    s->assigns = (uint8_t *) malloc(n_vars);
+    s->level = (uint32_t *) calloc(n_vars, sizeof(uint32_t));
+    s->reason = (clause_t **) calloc(n_vars, sizeof(clause_t *));
+    s->activity = (double *) calloc(n_vars, sizeof(double));
+    s->seen = (uint8_t *) calloc(n_vars, 1);
+    s->trail = (uint32_t *) malloc(n_vars * sizeof(uint32_t));
+    s->trail_lim = (uint32_t *) malloc((n_vars + 1) * sizeof(uint32_t));
+    s->watches = (clause_vec_t *) calloc(2 * n_vars, sizeof(clause_vec_t));
+    s->buf = (uint32_t *) malloc((n_vars + 1) * sizeof(uint32_t));
+    assert(s->assigns && s->level && s->reason && s->activity && s->seen);
+    assert(s->trail && s->trail_lim && s->watches && s->buf);
+    stats_alloc(MEM_SOLVER, solver_array_bytes(n_vars));
+    memset(s->assigns, VAL_UNDEF, n_vars);
+    s->max_learnts = 1000;
+    s->var_inc = 1.0;
+    s->cla_inc = 1.0;
+    s->check = check;
+    s->arg = arg;
+}
+
+static void solver_free(solver_t *s) {
+    uint32_t i;
+    for (i = 0; i < s->clauses.size; ++i) clause_free(s->clauses.data[i]);
+    for (i = 0; i < s->learnts.size; ++i) clause_free(s->learnts.data[i]);
+    for (i = 0; i < 2 * s->n_vars; ++i) {
+        stats_free(MEM_SOLVER, s->watches[i].capacity * sizeof(clause_t *));
+        free(s->watches[i].data);
+    }
+    stats_free(MEM_SOLVER, (s->clauses.capacity + s->learnts.capacity) *
+        sizeof(clause_t *) + solver_array_bytes(s->n_vars));
+    free(s->clauses.data);
+    free(s->learnts.data);
+    free(s->watches);
+    free(s->assigns);
+    free(s->level);
+    free(s->reason);
+    free(s->activity);
+    free(s->seen);
+    free(s->trail);
+    free(s->trail_lim);
+    free(s->buf);
+}
+
+static void enqueue(solver_t *s, uint32_t l, clause_t *reason) {
+    const uint32_t v = VAR(l);
+    assert(s->assigns[v] == VAL_UNDEF);
+    s->assigns[v] = (l & 1u) ? VAL_FALSE : VAL_TRUE;
+    s->level[v] = s->n_levels;
+    s->reason[v] = reason;
+    s->trail[s->trail_size++] = l;
+}
+
+static void backtrack(solver_t *s, uint32_t level) {
+    if (s->n_levels <= level) {
+        return;
+    }
+    uint32_t i;
+    for (i = s->trail_size; i > s->trail_lim[level]; --i) {
+        const uint32_t v = VAR(s->trail[i - 1]);
+        s->assigns[v] = VAL_UNDEF;
+        s->reason[v] = NULL;
+    }
+    s->trail_size = s->trail_lim[level];
+    s->qhead = s->trail_size;
+    s->n_levels = level;
+}
+
+static clause_t *clause_new(const uint32_t *lits, uint32_t size, uint8_t learnt) {
+    clause_t *c = (clause_t *) malloc(sizeof(clause_t) + size * sizeof(uint32_t));
+    assert(c != NULL);
+    stats_alloc(MEM_SOLVER, clause_bytes(size));
+    c->size = size;
+    c->learnt = learnt;
+    c->activity = 0.0;
+    memcpy(c->lits, lits, size * sizeof(uint32_t));
+    return c;
+}
+
+static void attach(solver_t *s, clause_t *c) {
+    assert(c->size >= 2);
+    vec_push(&s->watches[NEG(c->lits[0])], c);
+    vec_push(&s->watches[NEG(c->lits[1])], c);
+}
+
+static void bump_var(solver_t *s, uint32_t v) {
+    if ((s->activity[v] += s->var_inc) > 1e100) {
+        uint32_t i;
+        for (i = 0; i < s->n_vars; ++i) s->activity[i] *= 1e-100;
+        s->var_inc *= 1e-100;
+    }
+}
+
+static void bump_clause(solver_t *s, clause_t *c) {
+    if ((c->activity += s->cla_inc) > 1e20) {
+        uint32_t i;
+        for (i = 0; i < s->learnts.size; ++i) s->learnts.data[i]->activity *= 1e-20;
+        s->cla_inc *= 1e-20;
+    }
+}
+
+// Add clause at decision level 0; returns 0 if formula became unsat
+static uint8_t solver_add_clause(solver_t *s, const uint32_t *lits, uint32_t size) {
+    backtrack(s, 0);
+    uint32_t i, n = 0;
+    for (i = 0; i < size; ++i) {
+        const uint8_t val = lit_value(s, lits[i]);
+        if (val == VAL_TRUE) {
+            return 1;  // already satisfied
+        }
+        if (val == VAL_UNDEF) {
+            s->buf[n++] = lits[i];
+        }
+    }
+    if (n == 0) {
+        s->unsat = 1;
+    } else if (n == 1) {
+        enqueue(s, s->buf[0], NULL);
+    } else {
+        clause_t *c = clause_new(s->buf, n, 0);
+        vec_push(&s->clauses, c);
+        attach(s, c);
+    }
+    return !s->unsat;
+}
+
+// Add clause that is falsified by current total assignment (theory
+// conflict); it is analyzed like a regular conflict by the search and
+// kept permanently
+static void solver_add_conflict(solver_t *s, const uint32_t *lits, uint32_t size) {
+    assert(s->pending == NULL);
+    clause_t *c = clause_new(lits, size, 0);
+    // Watch the two literals assigned last
+    uint32_t i, j;
+    for (j = 0; j < 2 && j < size; ++j) {
+        for (i = j + 1; i < size; ++i) {
+            if (s->level[VAR(c->lits[i])] > s->level[VAR(c->lits[j])]) {
+                const uint32_t t = c->lits[i];
+                c->lits[i] = c->lits[j];
+                c->lits[j] = t;
+            }
+        }
+    }
+    s->pending = c;
+}
+
+// Unit propagation with two watched literals; returns conflicting
+// clause or NULL
+static clause_t *propagate(solver_t *s) {
+    while (s->qhead < s->trail_size) {
+        const uint32_t p = s->trail[s->qhead++];  // p became true
+        const uint32_t false_lit = NEG(p);
+        clause_vec_t *ws = &s->watches[p];
+        uint32_t i = 0, j = 0;
+        while (i < ws->size) {
+            clause_t *c = ws->data[i++];
+            // Make sure false literal is at position 1
+            if (c->lits[0] == false_lit) {
+                c->lits[0] = c->lits[1];
+                c->lits[1] = false_lit;
+            }
+            if (lit_value(s, c->lits[0]) == VAL_TRUE) {
+                ws->data[j++] = c;
+                continue;
+            }
+            // Look for new literal to watch
+            uint32_t k;
+            for (k = 2; k < c->size; ++k) {
+                if (lit_value(s, c->lits[k]) != VAL_FALSE) {
+                    c->lits[1] = c->lits[k];
+                    c->lits[k] = false_lit;
+                    vec_push(&s->watches[NEG(c->lits[1])], c);
+                    break;
+                }
+            }
+            if (k < c->size) {
+                continue;
+            }
+            // Clause is unit or conflicting
+            ws->data[j++] = c;
+            if (lit_value(s, c->lits[0]) == VAL_FALSE) {
+                while (i < ws->size) {
+                    ws->data[j++] = ws->data[i++];
+                }
+                ws->size = j;
+                s->qhead = s->trail_size;
+                return c;
+            }
+            enqueue(s, c->lits[0], c);
+        }
+        ws->size = j;
+    }
+    return NULL;
+}
+
+// First-UIP conflict analysis; stores learnt clause in buf (asserting
+// literal first) and returns its size and backjump level
+static uint32_t analyze(solver_t *s, clause_t *confl, uint32_t *bt_level) {
+    uint32_t size = 1, path = 0, index = s->trail_size;
+    uint32_t p = UINT32_MAX;
+    
+    do {
+        if (confl->learnt) {
+            bump_clause(s, confl);
+        }
+        uint32_t j;
+        for (j = (p == UINT32_MAX) ? 0 : 1; j < confl->size; ++j) {
+            const uint32_t q = confl->lits[j];
+            const uint32_t v = VAR(q);
+            if (!s->seen[v] && s->level[v] > 0) {
+                s->seen[v] = 1;
+                bump_var(s, v);
+                if (s->level[v] >= s->n_levels) {
+                    ++path;
+                } else {
+                    s->buf[size++] = q;
+                }
+            }
+        }
+        // Next literal on trail to expand
+        while (!s->seen[VAR(s->trail[--index])]);
+        p = s->trail[index];
+        confl = s->reason[VAR(p)];
+        s->seen[VAR(p)] = 0;
+        --path;
+    } while (path > 0);
+    s->buf[0] = NEG(p);
+    
+    // Backjump to second highest level in learnt clause
+    uint32_t i, max_i = 1;
+    *bt_level = 0;
+    for (i = 1; i < size; ++i) {
+        s->seen[VAR(s->buf[i])] = 0;
+        if (s->level[VAR(s->buf[i])] > *bt_level) {
+            *bt_level = s->level[VAR(s->buf[i])];
+            max_i = i;
+        }
+    }
+    if (size > 1) {
+        const uint32_t t = s->buf[1];
+        s->buf[1] = s->buf[max_i];
+        s->buf[max_i] = t;
+    }
+    return size;
+}
+
+// Learn from conflict; returns 0 if formula is unsat
+static uint8_t handle_conflict(solver_t *s, clause_t *confl) {
+    if (s->n_levels == 0) {
+        return 0;
+    }
+    uint32_t bt_level;
+    const uint32_t size = analyze(s, confl, &bt_level);
+    backtrack(s, bt_level);
+    if (size == 1) {
+        enqueue(s, s->buf[0], NULL);
+    } else {
+        clause_t *c = clause_new(s->buf, size, 1);
+        vec_push(&s->learnts, c);
+        attach(s, c);
+        bump_clause(s, c);
+        enqueue(s, s->buf[0], c);
+    }
+    s->var_inc /= VAR_DECAY;
+    s->cla_inc /= CLA_DECAY;
+    return 1;
+}
+
+static int compare_activity(const void *a, const void *b) {
+    const double x = (*(clause_t * const *) a)->activity;
+    const double y = (*(clause_t * const *) b)->activity;
+    return (x < y) ? -1 : (x > y);
+}
+
+// Remove half of the learnt clauses with lowest activity. Only called
+// at level 0, where no learnt clause is reason for an assignment.
+static void reduce_learnts(solver_t *s) {
+    assert(s->n_levels == 0);
+    qsort(s->learnts.data, s->learnts.size, sizeof(clause_t *), compare_activity);
+    uint32_t i, j = 0;
+    const uint32_t limit = s->learnts.size / 2;
+    for (i = 0; i < s->learnts.size; ++i) {
+        clause_t *c = s->learnts.data[i];
+        if (i < limit && c->size > 2 && s->reason[VAR(c->lits[0])] != c) {
+            clause_free(c);
+        } else {
+            s->learnts.data[j++] = c;
+        }
+    }
+    s->learnts.size = j;
+    // Rebuild watch lists, watching non-false literals first
+    for (i = 0; i < 2 * s->n_vars; ++i) {
+        s->watches[i].size = 0;
+    }
+    clause_vec_t *sets[2] = {&s->clauses, &s->learnts};
+    uint32_t k;
+    for (k = 0; k < 2; ++k) {
+        for (i = 0; i < sets[k]->size; ++i) {
+            clause_t *c = sets[k]->data[i];
+            uint32_t a, n = 0;
+            for (a = 0; a < c->size && n < 2; ++a) {
+                if (lit_value(s, c->lits[a]) != VAL_FALSE) {
+                    const uint32_t t = c->lits[n];
+                    c->lits[n++] = c->lits[a];
+                    c->lits[a] = t;
+                }
+            }
+            attach(s, c);
+        }
+    }
+    s->max_learnts += s->max_learnts / 10;
+}
+
+// Restart intervals following Luby sequence 1 1 2 1 1 2 4 ...
+static uint32_t luby(uint32_t i) {
+    uint32_t size = 1, seq = 0;
+    while (size < i + 1) {
+        ++seq;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) >> 1;
+        --seq;
+        i = i % size;
+    }
+    return 1u << seq;
+}
+
+// Returns 1 once theory accepts a model, 0 if formula is unsat and
+// CDCL_UNKNOWN if run was stopped
+static uint8_t solver_solve(solver_t *s) {
+    if (s->unsat) {
+        return 0;
+    }
+    uint32_t restarts = 0;
+    uint64_t conflicts = 0, limit = RESTART_BASE * luby(0);
+    
+    for (;;) {
+        clause_t *confl = propagate(s);
+        if (confl != NULL) {
+            if (control_poll(0)) {
+                return CDCL_UNKNOWN;
+            }
+            if (!handle_conflict(s, confl)) {
+                s->unsat = 1;
+                return 0;
+            }
+            if (++conflicts >= limit) {
+                // Restart
+                backtrack(s, 0);
+                limit = conflicts + RESTART_BASE * luby(++restarts);
+                if (s->learnts.size > s->max_learnts) {
+                    reduce_learnts(s);
+                }
+            }
+            continue;
+        }
+        // Decide unassigned variable of highest activity, false first
+        uint32_t v, best = UINT32_MAX;
+        for (v = 0; v < s->n_vars; ++v) {
+            if (s->assigns[v] == VAL_UNDEF &&
+                (best == UINT32_MAX || s->activity[v] > s->activity[best])) {
+                best = v;
+            }
+        }
+        if (best != UINT32_MAX) {
+            s->trail_lim[s->n_levels++] = s->trail_size;
+            enqueue(s, LIT(best, 1), NULL);
+            continue;
+        }
+        // Total assignment: consult theory
+        if (control_poll(0)) {
+            return CDCL_UNKNOWN;
+        }
+        if (s->check(s, s->arg)) {
+            return 1;
+        }
+        // Theory added falsified clause: jump to highest level it
+        // depends on and analyze it as conflict
+        clause_t *c = s->pending;
+        s->pending = NULL;
+        assert(c != NULL);
+        if (c->size == 0 || s->level[VAR(c->lits[0])] == 0) {
+            clause_free(c);
+            s->unsat = 1;
+            return 0;
+        }
+        backtrack(s, s->level[VAR(c->lits[0])]);
+        if (c->size == 1) {
+            // Unit clause holds at level 0
+            backtrack(s, 0);
+            enqueue(s, c->lits[0], NULL);
+            clause_free(c);
+            continue;
+        }
+        vec_push(&s->clauses, c);
+        attach(s, c);
+        if (!handle_conflict(s, c)) {
+            s->unsat = 1;
+            return 0;
+        }
+    }
+}
+
+/*
+ * Key problems
+ * 
+ */
+
+// Attribute sets of the key problems, including both sides of each
+// FD, are vectors of n_words 64-bit words, so the solver is not bound
+// to the width of Set. Set is only used to read FDs from the queue and
+// to hand keys back.
+#define WORD_BITS 64u
+#define NO_ATTRIB UINT32_MAX
+#define BIT_TEST(b, i) (((b)[(i) / WORD_BITS] >> ((i) % WORD_BITS)) & 1u)
+#define BIT_SET(b, i) ((b)[(i) / WORD_BITS] |= 1ull << ((i) % WORD_BITS))
+#define BIT_CLEAR(b, i) ((b)[(i) / WORD_BITS] &= ~(1ull << ((i) % WORD_BITS)))
+
+typedef struct {
+    uint32_t n_attribs;
+    uint32_t n_words;
+    uint32_t n_fds;
+    uint64_t *sides;    // lhs and rhs words of FD f at 2 * n_words * f
+    uint64_t *full;     // all attributes
+    uint64_t *closure;  // result of last closure
+} fd_words_t;
+
+typedef struct {
+    fd_words_t fds;
+    uint32_t attrib;    // prime query only
+    uint8_t is_prime;   // prime query: attrib must stay essential
+    uint32_t n_keys;
+    uint8_t enumerate;  // print keys and block them instead of stopping
+    uint64_t *key;      // last candidate key found
+    uint64_t *model;    // attributes set to true in assignment
+    uint64_t *closed;   // maximal closed set grown from model
+    uint64_t *grown;
+} key_problem_t;
+
+static uint64_t fd_words_bytes(const fd_words_t *fi) {
+    return (2 * (uint64_t) fi->n_fds + 2) * fi->n_words * sizeof(uint64_t);
+}
+
+// Copy FDs of q into word vectors
+static void fd_words_init(fd_words_t *fi, const Queue *q, uint8_t n_attribs) {
+    assert(n_attribs <= MAX_ATTRIBS);
+    fi->n_attribs = n_attribs;
+    fi->n_words = n_attribs / WORD_BITS + 1;
+    fi->n_fds = q->size;
+    fi->full = (uint64_t *) calloc(1, fd_words_bytes(fi));
+    assert(fi->full != NULL);
+    stats_alloc(MEM_SOLVER, fd_words_bytes(fi));
+    fi->closure = fi->full + fi->n_words;
+    fi->sides = fi->closure + fi->n_words;
+    
+    uint32_t a;
+    for (a = 0; a < n_attribs; ++a) {
+        BIT_SET(fi->full, a);
+    }
+    uint64_t *side = fi->sides;
+    Q_iterator_t iter;
+    for (iter = Q_iterator(q); iter; iter = iter->next) {
+        side[0] = iter->key.lhs.set;
+        side[fi->n_words] = iter->key.rhs.set;
+        side += 2 * fi->n_words;
+    }
+}
+
+static void fd_words_free(fd_words_t *fi) {
+    stats_free(MEM_SOLVER, fd_words_bytes(fi));
+    free(fi->full);
+}
+
+static uint8_t words_contain(const uint64_t *s, const uint64_t *t,
+    uint32_t n_words) {
+    
+    uint32_t i;
+    for (i = 0; i < n_words; ++i) {
+        if (t[i] & ~s[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Closure for up to 63 attributes, kept in a register while FDs are
+// scanned
+static uint8_t closure_word(const fd_words_t *fi, uint64_t *out) {
+    const uint64_t full = fi->full[0];
+    uint64_t closure = *out;
+    uint8_t is_new_attrib = 1;
+    while (is_new_attrib) {
+        is_new_attrib = 0;
+        STATS_ADD(fd_scans, fi->n_fds);
+        const uint64_t *side = fi->sides;
+        uint32_t f;
+        for (f = 0; f < fi->n_fds; ++f, side += 2) {
+            if (!(side[0] & ~closure) && (side[1] & ~closure)) {
+                closure |= side[1];
+                if (closure == full) {
+                    goto end;  // nothing left to add
+                }
+                is_new_attrib = 1;
+            }
+        }
+    }
+
+end:
+    *out = closure;
+    return closure == full;
+}
+
+static uint8_t closure_words(const fd_words_t *fi, uint64_t *closure) {
+    const uint32_t n_words = fi->n_words;
+    uint8_t is_new_attrib = 1;
+    while (is_new_attrib) {
+        is_new_attrib = 0;
+        STATS_ADD(fd_scans, fi->n_fds);
+        const uint64_t *side = fi->sides;
+        uint32_t f, i;
+        for (f = 0; f < fi->n_fds; ++f, side += 2 * n_words) {
+            const uint64_t *rhs = side + n_words;
+            if (words_contain(closure, side, n_words) &&
+                !words_contain(closure, rhs, n_words)) {
+                
+                for (i = 0; i < n_words; ++i) {
+                    closure[i] |= rhs[i];
+                }
+                if (words_contain(closure, fi->full, n_words)) {
+                    return 1;  // nothing left to add
+                }
+                is_new_attrib = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Compute closure of s into fi->closure; returns 1 if it holds all
+// attributes
+static uint8_t fd_closure(fd_words_t *fi, const uint64_t *s) {
+    memcpy(fi->closure, s, fi->n_words * sizeof(uint64_t));
+    STATS_ADD(closure_calls, 1);
+    if (words_contain(fi->closure, fi->full, fi->n_words)) {
+        return 1;
+    }
+    perf_region_begin(PERF_REGION_CLOSURE);
+    const uint8_t full = (fi->n_words == 1) ? closure_word(fi, fi->closure) :
+        closure_words(fi, fi->closure);
+    perf_region_end(PERF_REGION_CLOSURE);
+    return full;
+}
+
+static uint8_t bits_superkey(key_problem_t *kp, const uint64_t *s) {
+    STATS_ADD(superkey_tests, 1);
+    return fd_closure(&kp->fds, s);
+}
+
+static void key_problem_init(key_problem_t *kp, const Queue *q,
+    uint8_t n_attribs) {
+    
+    fd_words_init(&kp->fds, q, n_attribs);
+    const uint32_t n_words = kp->fds.n_words;
+    kp->key = (uint64_t *) calloc(4 * n_words, sizeof(uint64_t));
+    assert(kp->key != NULL);
+    stats_alloc(MEM_SOLVER, 4 * n_words * sizeof(uint64_t));
+    kp->model = kp->key + n_words;
+    kp->closed = kp->model + n_words;
+    kp->grown = kp->closed + n_words;
+}
+
+static void key_problem_free(key_problem_t *kp) {
+    stats_free(MEM_SOLVER, 4 * kp->fds.n_words * sizeof(uint64_t));
+    free(kp->key);
+    fd_words_free(&kp->fds);
+}
+
+// Attributes of found key as Set
+static Set key_set(const key_problem_t *kp) {
+    Set key;
+    Set_init(&key);
+    uint32_t a;
+    for (a = 0; a < kp->fds.n_attribs; ++a) {
+        if (BIT_TEST(kp->key, a)) {
+            Set_insert(&key, (uint8_t) a);
+        }
+    }
+    return key;
+}
+
+// Attributes set to true in current assignment
+static void model_bits(const solver_t *s, key_problem_t *kp) {
+    memset(kp->model, 0, kp->fds.n_words * sizeof(uint64_t));
+    uint32_t a;
+    for (a = 0; a < kp->fds.n_attribs; ++a) {
+        if (s->assigns[a] == VAL_TRUE) {
+            BIT_SET(kp->model, a);
+        }
+    }
+}
+
+// Drop non-essential attributes of super-key s except keep
+// (NO_ATTRIB: none), which leaves a candidate key if nothing is kept
+static void minimize(key_problem_t *kp, uint64_t *s, uint32_t keep) {
+    uint32_t a;
+    for (a = 0; a < kp->fds.n_attribs; ++a) {
+        if (a == keep || !BIT_TEST(s, a)) {
+            continue;
+        }
+        BIT_CLEAR(s, a);
+        if (!bits_superkey(kp, s)) {
+            BIT_SET(s, a);
+        }
+    }
+}
+
+// Learn that some attribute outside a maximal closed set containing
+// the model belongs to every super-key
+static void add_superkey_cut(solver_t *s, key_problem_t *kp) {
+    const uint32_t n_attribs = kp->fds.n_attribs;
+    const size_t bytes = kp->fds.n_words * sizeof(uint64_t);
+    fd_closure(&kp->fds, kp->model);
+    memcpy(kp->closed, kp->fds.closure, bytes);
+    uint32_t i, n = 0;
+    for (i = 0; i < n_attribs; ++i) {
+        if (BIT_TEST(kp->closed, i)) {
+            continue;
+        }
+        memcpy(kp->grown, kp->closed, bytes);
+        BIT_SET(kp->grown, i);
+        if (!fd_closure(&kp->fds, kp->grown)) {
+            memcpy(kp->closed, kp->fds.closure, bytes);
+        }
+    }
+    for (i = 0; i < n_attribs; ++i) {
+        if (!BIT_TEST(kp->closed, i)) {
+            s->buf[n++] = LIT(i, 0);
+        }
+    }
+    solver_add_conflict(s, s->buf, n);
+}
+
+// Block candidate key (and all its supersets), optionally only in
+// combination with extra attribute
+static void add_blocking(solver_t *s, const key_problem_t *kp,
+    const uint64_t *ckey, uint32_t extra) {
+    
+    uint32_t a, n = 0;
+    for (a = 0; a < kp->fds.n_attribs; ++a) {
+        if (BIT_TEST(ckey, a)) {
+            s->buf[n++] = LIT(a, 1);
+        }
+    }
+    if (extra != NO_ATTRIB) {
+        s->buf[n++] = LIT(extra, 1);
+    }
+    solver_add_conflict(s, s->buf, n);
+}
+
+static uint8_t key_check(solver_t *s, void *arg) {
+    key_problem_t *kp = (key_problem_t *) arg;
+    const size_t bytes = kp->fds.n_words * sizeof(uint64_t);
+    model_bits(s, kp);
+    if (!bits_superkey(kp, kp->model)) {
+        add_superkey_cut(s, kp);
+        return 0;
+    }
+    if (kp->is_prime) {
+        // Drop other attributes first; attrib is prime if it remains
+        // essential
+        minimize(kp, kp->model, kp->attrib);
+        BIT_CLEAR(kp->model, kp->attrib);
+        if (!bits_superkey(kp, kp->model)) {
+            BIT_SET(kp->model, kp->attrib);
+            memcpy(kp->key, kp->model, bytes);
+            return 1;
+        }
+        // Key without attrib: no key with attrib contains it
+        minimize(kp, kp->model, NO_ATTRIB);
+        add_blocking(s, kp, kp->model, kp->attrib);
+        return 0;
+    }
+    memcpy(kp->key, kp->model, bytes);
+    minimize(kp, kp->key, NO_ATTRIB);
+    if (!kp->enumerate) {
+        ++kp->n_keys;
+        return 1;
+    }
+    if (control_key_found()) {
+        return 1;  // stop enumeration
+    }
+    ++kp->n_keys;
+    const Set key = key_set(kp);
+    output_key(&key);
+    add_blocking(s, kp, kp->key, NO_ATTRIB);
+    return 0;
+}
+
+// Print all candidate keys; every key found is excluded together with
+// its supersets by a blocking clause
+void print_all_candidate_keys_cdcl(const Queue *q, uint8_t n_attribs) {
+    key_problem_t kp = {.enumerate = 1};
+    key_problem_init(&kp, q, n_attribs);
+    solver_t s;
+    solver_init(&s, n_attribs, key_check, &kp);
+    solver_solve(&s);
+    output_flush();
+    printf("Number of candidate keys: %u\n", kp.n_keys);
+    solver_free(&s);
+    key_problem_free(&kp);
+}
+
+// Sequential counter encoding (Sinz 2005) of x_0 + ... + x_{n-1} <= k
+// with auxiliary variables s_{i,j} = n + i * k + j
+static void add_at_most(solver_t *s, uint32_t n, uint32_t k) {
+    uint32_t c[3];
+    uint32_t i, j;
+    if (k == 0) {
+        for (i = 0; i < n; ++i) {
+            c[0] = LIT(i, 1);
+            solver_add_clause(s, c, 1);
+        }
+        return;
+    }
+#define AUX(i, j) (n + (i) * k + (j))
+    for (i = 0; i < n; ++i) {
+        // x_i -> s_{i,0}
+        c[0] = LIT(i, 1); c[1] = LIT(AUX(i, 0), 0);
+        solver_add_clause(s, c, 2);
+        if (i == 0) {
+            for (j = 1; j < k; ++j) {
+                c[0] = LIT(AUX(0, j), 1);
+                solver_add_clause(s, c, 1);
+            }
+            continue;
+        }
+        for (j = 0; j < k; ++j) {
+            // s_{i-1,j} -> s_{i,j}
+            c[0] = LIT(AUX(i - 1, j), 1); c[1] = LIT(AUX(i, j), 0);
+            solver_add_clause(s, c, 2);
+            if (j > 0) {
+                // x_i and s_{i-1,j-1} -> s_{i,j}
+                c[0] = LIT(i, 1); c[1] = LIT(AUX(i - 1, j - 1), 1);
+                c[2] = LIT(AUX(i, j), 0);
+                solver_add_clause(s, c, 3);
+            }
+        }
+        // x_i and s_{i-1,k-1} -> overflow
+        c[0] = LIT(i, 1); c[1] = LIT(AUX(i - 1, k - 1), 1);
+        solver_add_clause(s, c, 2);
+    }
+#undef AUX
+}
+
+// Check if there is a candidate key of at most k attributes and store
+// it in key
+uint8_t cdcl_has_key_of_size(const Queue *q, uint8_t n_attribs, uint8_t k,
+    Set *key) {
+    
+    key_problem_t kp = {0};
+    key_problem_init(&kp, q, n_attribs);
+    uint8_t found;
+    if (k >= n_attribs) {
+        uint32_t a;
+        for (a = 0; a < n_attribs; ++a) {
+            BIT_SET(kp.key, a);
+        }
+        minimize(&kp, kp.key, NO_ATTRIB);
+        found = 1;
+    } else {
+        solver_t s;
+        solver_init(&s, n_attribs + (uint32_t) n_attribs * k, key_check, &kp);
+        add_at_most(&s, n_attribs, k);
+        found = solver_solve(&s);
+        solver_free(&s);
+    }
+    if (found == 1) {
+        *key = key_set(&kp);
+    }
+    key_problem_free(&kp);
+    return found;
+}
+
+// Check if attribute is contained in some candidate key (prime) and
+// store witness key
+uint8_t cdcl_is_prime(const Queue *q, uint8_t n_attribs, uint8_t attrib,
+    Set *key) {
+    
+    assert(attrib < n_attribs);
+    key_problem_t kp = {.attrib = attrib, .is_prime = 1};
+    key_problem_init(&kp, q, n_attribs);
+    solver_t s;
+    solver_init(&s, n_attribs, key_check, &kp);
+    const uint32_t unit = LIT(attrib, 0);
+    solver_add_clause(&s, &unit, 1);
+    const uint8_t found = solver_solve(&s);
+    if (found == 1) {
+        *key = key_set(&kp);
+    }
+    solver_free(&s);
+    key_problem_free(&kp);
+    return found;
+}
@@ -0,0 +1,189 @@
+#include "checkpoint.h"
+#include "queue.h"
+#include "set.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAGIC "FDCKPT01"
+#define MAGIC_LEN 8
+
+// Running FNV-1a checksum over all bytes written/read after magic
+static uint32_t fnv1a(uint32_t h, const uint8_t *data, size_t len) {
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static int8_t put_u32(FILE *fp, uint32_t value, uint32_t *h) {
+    const uint8_t bytes[4] = {(uint8_t) value, (uint8_t)(value >> 8),
+                              (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    *h = fnv1a(*h, bytes, 4);
+    return fwrite(bytes, 1, 4, fp) == 4 ? 0 : 1;
+}
+
+static int8_t get_u32(FILE *fp, uint32_t *value, uint32_t *h) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, fp) != 4) {
+        return 1;
+    }
+    *h = fnv1a(*h, bytes, 4);
+    *value = (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 |
+             (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+    return 0;
+}
+
+// Write lhs masks (and rhs masks if with_rhs) of queue from tail to head
+static int8_t put_queue(FILE *fp, const Queue *q, uint8_t with_rhs, uint32_t *h) {
+    int8_t ierr = put_u32(fp, q->size, h);
+    Q_iterator_t iter = Q_iterator(q);
+    while (iter && !ierr) {
+        ierr = put_u32(fp, iter->key.lhs.set, h);
+        if (with_rhs && !ierr) {
+            ierr = put_u32(fp, iter->key.rhs.set, h);
+        }
+        iter = iter->next;
+    }
+    return ierr;
+}
+
+static int8_t get_keys(FILE *fp, Queue *keys, uint8_t n_attribs, uint32_t *h) {
+    uint32_t size, mask, i;
+    if (get_u32(fp, &size, h)) {
+        return 1;
+    }
+    for (i = 0; i < size; ++i) {
+        if (get_u32(fp, &mask, h) || (mask >> n_attribs) != 0) {
+            return 1;
+        }
+        Set key;
+        Set_init(&key);
+        key.set = mask;
+        key.size = __builtin_popcount(mask);
+        Q_insert(keys, (q_key_t) {.lhs = key, .rhs = (Set) {0}});
+    }
+    return 0;
+}
+
+// Flush directory containing path to disk, so that a rename in it
+// survives a crash; returns 0 on success
+static int8_t sync_parent_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const size_t len = slash == NULL ? 1 : slash == path ? 1 :
+                       (size_t)(slash - path);
+    char *dir = (char *) malloc(len + 1);
+    if (dir == NULL) {
+        return 1;
+    }
+    memcpy(dir, slash == NULL ? "." : path, len);
+    dir[len] = '\0';
+    const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd < 0) {
+        return 1;
+    }
+    // File systems that cannot sync directories report EINVAL
+    const int8_t ierr = fsync(fd) != 0 && errno != EINVAL;
+    return (close(fd) != 0) || ierr;
+}
+
+// Write enumeration state to path; returns 0 on success
+int8_t checkpoint_write(const char *path, const Queue *q, uint8_t n_attribs,
+    const Queue *ckeys, const Queue *work) {
+    
+    // Write to temporary file first and rename it over old checkpoint
+    const size_t len = strlen(path);
+    char *tmp_path = (char *) malloc(len + 5);
+    if (tmp_path == NULL) {
+        fprintf(stderr, "Could not write checkpoint to '%s'!\n", path);
+        return 1;
+    }
+    memcpy(tmp_path, path, len);
+    memcpy(tmp_path + len, ".tmp", 5);
+    const uint64_t span = trace_start();
+    
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write checkpoint to '%s'!\n", tmp_path);
+        free(tmp_path);
+        return 1;
+    }
+    uint32_t h = 2166136261u;
+    int8_t ierr = fwrite(MAGIC, 1, MAGIC_LEN, fp) != MAGIC_LEN;
+    ierr = ierr || put_u32(fp, n_attribs, &h);
+    ierr = ierr || put_queue(fp, q, 1, &h);
+    ierr = ierr || put_queue(fp, ckeys, 0, &h);
+    ierr = ierr || put_queue(fp, work, 0, &h);
+    uint32_t checksum = h;
+    ierr = ierr || put_u32(fp, checksum, &h);
+    // Data must be on disk before rename makes it visible
+    ierr = ierr || fflush(fp) != 0 || fsync(fileno(fp)) != 0;
+    ierr = (fclose(fp) != 0) || ierr;
+    if (!ierr && rename(tmp_path, path) != 0) {
+        ierr = 1;
+    }
+    // Rename is only durable once the directory entry is on disk
+    ierr = ierr || sync_parent_dir(path);
+    if (ierr) {
+        fprintf(stderr, "Could not write checkpoint to '%s'!\n", path);
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    trace_end("checkpoint", span);
+    return ierr;
+}
+
+// Read enumeration state from path into (empty) queues ckeys and work,
+// checking that it belongs to FDs q; returns 0 on success
+int8_t checkpoint_read(const char *path, const Queue *q, uint8_t n_attribs,
+    Queue *ckeys, Queue *work) {
+    
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open checkpoint at '%s'!\n", path);
+        return 1;
+    }
+    char magic[MAGIC_LEN];
+    uint32_t h = 2166136261u, value, n_fds, lhs, rhs, checksum, expected;
+    int8_t ierr = fread(magic, 1, MAGIC_LEN, fp) != MAGIC_LEN ||
+                  memcmp(magic, MAGIC, MAGIC_LEN) != 0;
+    if (ierr) {
+        fprintf(stderr, "'%s' is not a checkpoint file\n", path);
+        fclose(fp);
+        return 1;
+    }
+    // Checkpoint must belong to the same functional dependencies
+    uint8_t matches = !get_u32(fp, &value, &h) && value == n_attribs &&
+                      !get_u32(fp, &n_fds, &h) && n_fds == q->size;
+    Q_iterator_t iter = Q_iterator(q);
+    while (matches && iter) {
+        matches = !get_u32(fp, &lhs, &h) && !get_u32(fp, &rhs, &h) &&
+                  lhs == iter->key.lhs.set && rhs == iter->key.rhs.set;
+        iter = iter->next;
+    }
+    if (!matches) {
+        fprintf(stderr, "Checkpoint '%s' does not match functional "
+            "dependencies\n", path);
+        fclose(fp);
+        return 1;
+    }
+    ierr = get_keys(fp, ckeys, n_attribs, &h) ||
+           get_keys(fp, work, n_attribs, &h);
+    expected = h;
+    ierr = ierr || get_u32(fp, &checksum, &h) || checksum != expected;
+    fclose(fp);
+    if (ierr) {
+        fprintf(stderr, "Checkpoint '%s' is corrupt\n", path);
+        Q_free(ckeys);
+        Q_free(work);
+    }
+    return ierr;
+}
@@ -0,0 +1,138 @@
+#include "control.h"
+#include "stats.h"
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Clock is consulted only on every POLL_PERIOD-th poll of a thread
+#define POLL_PERIOD 16u
+
+static volatile sig_atomic_t interrupted = 0;
+static atomic_int stop_reason = STOP_NONE;
+static atomic_uint_fast64_t n_keys = 0;
+static atomic_uint_fast64_t next_progress_ns = 0;
+
+static struct timespec start;
+static uint64_t time_limit_ns = 0;
+static uint64_t progress_ns = 0;
+static uint64_t key_limit = 0;
+static _Thread_local uint32_t poll_count = 0;
+
+static uint64_t elapsed_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000000ull +
+           (uint64_t) now.tv_nsec - (uint64_t) start.tv_nsec;
+}
+
+static void on_signal(int sig) {
+    (void) sig;
+    interrupted = 1;
+}
+
+static void set_stop(int reason) {
+    int expected = STOP_NONE;
+    atomic_compare_exchange_strong(&stop_reason, &expected, reason);
+}
+
+// Start run with limits (0: none) and progress interval in seconds
+// (0: no progress reports)
+void control_init(double time_limit, uint64_t max_keys,
+    double progress_interval) {
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    time_limit_ns = (uint64_t)(time_limit * 1e9);
+    progress_ns = (uint64_t)(progress_interval * 1e9);
+    key_limit = max_keys;
+    atomic_store(&stop_reason, STOP_NONE);
+    atomic_store(&n_keys, 0);
+    atomic_store(&next_progress_ns, progress_ns);
+}
+
+// Stop gracefully on SIGINT/SIGTERM; a second signal terminates
+void control_install_signals(void) {
+    struct sigaction sa;
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+// Check limits and print progress if due; returns 1 if the engine
+// should stop. queue_depth is the amount of pending work.
+uint8_t control_poll(uint64_t queue_depth) {
+    stats_queue_depth(queue_depth);
+    if (atomic_load_explicit(&stop_reason, memory_order_relaxed) != STOP_NONE) {
+        return 1;
+    }
+    if (interrupted) {
+        set_stop(STOP_SIGNAL);
+        return 1;
+    }
+    if ((++poll_count % POLL_PERIOD) != 0 || (!time_limit_ns && !progress_ns)) {
+        return 0;
+    }
+    const uint64_t now = elapsed_ns();
+    if (time_limit_ns && now >= time_limit_ns) {
+        set_stop(STOP_TIME);
+        return 1;
+    }
+    uint_fast64_t due = atomic_load_explicit(&next_progress_ns, memory_order_relaxed);
+    // Only thread advancing the deadline prints
+    if (progress_ns && now >= due &&
+        atomic_compare_exchange_strong(&next_progress_ns, &due, now + progress_ns)) {
+        const uint64_t keys = atomic_load(&n_keys);
+        const double seconds = now * 1e-9;
+        fprintf(stderr, "[progress] %.1f s: %lu keys, work queue %lu, %.1f keys/s\n",
+            seconds, (unsigned long) keys, (unsigned long) queue_depth,
+            keys / seconds);
+    }
+    return 0;
+}
+
+// Count key before emitting it; returns 1 if it lies beyond the key
+// limit
+uint8_t control_key_found(void) {
+    const uint64_t keys = atomic_fetch_add(&n_keys, 1) + 1;
+    if (key_limit && keys > key_limit) {
+        set_stop(STOP_KEYS);
+        return 1;
+    }
+    return 0;
+}
+
+// Nanoseconds since run started
+uint64_t control_elapsed_ns(void) {
+    return elapsed_ns();
+}
+
+// Number of keys counted so far (at most the key limit)
+uint64_t control_keys_found(void) {
+    const uint64_t keys = atomic_load(&n_keys);
+    return key_limit && keys > key_limit ? key_limit : keys;
+}
+
+// Check if run was stopped (without polling clock)
+uint8_t control_stopped(void) {
+    return atomic_load_explicit(&stop_reason, memory_order_relaxed) != STOP_NONE;
+}
+
+// Print note marking output as partial if run was stopped
+void control_report(void) {
+    static const char *reasons[] = {
+        [STOP_TIME]   = "time limit",
+        [STOP_KEYS]   = "key limit",
+        [STOP_SIGNAL] = "signal"
+    };
+    const int reason = atomic_load(&stop_reason);
+    if (reason == STOP_NONE) {
+        return;
+    }
+    printf("PARTIAL RESULT: stopped by %s after %.3f s and %lu keys\n",
+        reasons[reason], elapsed_ns() * 1e-9,
+        (unsigned long) control_keys_found());
+}
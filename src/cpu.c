@@ -0,0 +1,33 @@
+#include "cpu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Append name of extension to list if CPU supports it (name must be a
+// literal for __builtin_cpu_supports)
+#define ADD_FEATURE(buf, len, name)                                     \
+    if (__builtin_cpu_supports(name)) {                                 \
+        len += (size_t) snprintf(buf + len, sizeof(buf) - len, "%s%s",  \
+            len ? " " : "", name);                                      \
+    }
+
+// Names of instruction set extensions the running CPU offers to
+// dispatched kernels
+const char *cpu_features(void) {
+    static char names[64];
+    if (names[0] != '\0') {
+        return names;
+    }
+#if CPU_DISPATCH
+    size_t len = 0;
+    __builtin_cpu_init();
+    ADD_FEATURE(names, len, "popcnt");
+    ADD_FEATURE(names, len, "bmi");
+    ADD_FEATURE(names, len, "avx2");
+    ADD_FEATURE(names, len, "avx512f");
+#endif
+    if (names[0] == '\0') {
+        strcpy(names, "baseline");
+    }
+    return names;
+}
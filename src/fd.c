@@ -0,0 +1,322 @@
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "stats.h"
+#include "perf.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compute closure of a set of attributes for given queues consisting
+// of attributes of left/right sides of all functional dependencies
+Set compute_closure(const Set *s, const Queue *q, uint8_t n_attribs) {
+    // Output
+    Set closure;
+    Set_copy(&closure, s);
+    STATS_ADD(closure_calls, 1);
+    perf_region_begin(PERF_REGION_CLOSURE);
+    
+    uint8_t is_new_attrib = 1;
+    while (is_new_attrib) {
+        // Set no new attrib found
+        is_new_attrib = 0;
+        // Iterate through all functional dependencies
+        Q_iterator_t iter = Q_iterator(q);
+        STATS_ADD(fd_scans, q->size);
+        
+        while (iter) {
+            // Check if left-hand side is already contained in closure
+            // while right-side is not
+            if (Set_contains(&closure, &iter->key.lhs) &&
+                !Set_contains(&closure, &iter->key.rhs)) {
+                
+                // Add right-hand side to out
+                closure = Set_union(&closure, &iter->key.rhs);
+                // Check if closure is already full
+                if (Set_is_full(&closure, n_attribs)) {
+                    goto end;  // nothing left to add
+                }
+                // Found new attribute(s)
+                is_new_attrib = 1;
+            }
+            // Advance iterators
+            iter = iter->next;
+        }
+    }
+
+end:
+    perf_region_end(PERF_REGION_CLOSURE);
+    return closure;
+}
+
+static uint8_t superkey_closure(const Set *s, const Queue *q,
+    uint8_t n_attribs) {
+    // Output
+    Set closure;
+    Set_copy(&closure, s);
+    STATS_ADD(closure_calls, 1);
+    STATS_ADD(superkey_tests, 1);
+    // Set of all attributes is trivially a super-key
+    if (Set_is_full(&closure, n_attribs)) {
+        return 1;
+    }
+    
+    uint8_t is_new_attrib = 1;
+    while (is_new_attrib) {
+        // Set no new attrib found
+        is_new_attrib = 0;
+        // Iterate through all functional dependencies
+        Q_iterator_t iter = Q_iterator(q);
+        STATS_ADD(fd_scans, q->size);
+        
+        while (iter) {
+            // Check if left-hand side is already contained in closure
+            // while right-side is not
+            if (Set_contains(&closure, &iter->key.lhs) &&
+                !Set_contains(&closure, &iter->key.rhs)) {
+                
+                // Add right-hand side to out
+                closure = Set_union(&closure, &iter->key.rhs);
+                if (Set_is_full(&closure, n_attribs)) {
+                    return 1;  // Set s is super-key
+                }
+                // Found new attribute(s)
+                is_new_attrib = 1;
+            }
+            // Advance iterators
+            iter = iter->next;
+        }
+    }
+    
+    return 0;
+}
+
+// Check if set of attributes s is a super-key given functional
+// dependencies in l -> r
+uint8_t is_superkey(const Set *s, const Queue *q, uint8_t n_attribs) {
+    perf_region_begin(PERF_REGION_CLOSURE);
+    const uint8_t result = superkey_closure(s, q, n_attribs);
+    perf_region_end(PERF_REGION_CLOSURE);
+    return result;
+}
+
+// From paper: Candidate Keys for Relations (journal of computer and
+// system sciences 1978) by Claudio Lucchesi and Sylvia Osborn.
+// Algorithm. Minimal Key (A, D[0], K)
+Set candidate_key_from_super_key(Set *skey, const Queue *q, uint8_t n_attribs) {
+    Set ckey, temp;
+    const uint64_t span = trace_start();
+    // Copy attributes
+    Set_copy(&ckey, skey);
+    
+    // Iterate over attributes of super-key
+    uint8_t i, attrib;
+    for (i = 0; i < skey->size; ++i) {
+        // Fetch current attribute
+        attrib = Set_next_pos(skey);
+        // Copy ckey into temp
+        Set_copy(&temp, &ckey);
+        // Remove attribute from temp
+        Set_remove(&temp, attrib);
+        // Check if ckey - attrib is still a super-key
+        if (is_superkey(&temp, q, n_attribs)) {
+            // Attribute attrib is non-essential to ckey -> remove
+            Set_copy(&ckey, &temp);
+        }
+    }
+    trace_end("minimize", span);
+    return ckey;
+}
+
+// Closures of a search: by closure if given, else under FDs of q
+typedef struct {
+    const Queue *q;
+    uint8_t n_attribs;
+    closure_fn closure;
+    void *arg;
+} closure_src_t;
+
+static Set src_closure(const closure_src_t *src, const Set *s) {
+    return src->closure != NULL ? src->closure(s, src->arg) :
+        compute_closure(s, src->q, src->n_attribs);
+}
+
+static uint8_t src_is_superkey(const closure_src_t *src, const Set *s) {
+    if (src->closure == NULL) {
+        return is_superkey(s, src->q, src->n_attribs);
+    }
+    const Set closure = src->closure(s, src->arg);
+    return Set_is_full(&closure, src->n_attribs);
+}
+
+// Check if some attribute of s is implied by the remaining ones. Then
+// no superset of s can be a candidate key.
+static uint8_t has_redundant_attrib(const Set *s, const closure_src_t *src) {
+    
+    Set iter, temp, closure;
+    Set_copy(&iter, s);
+    uint8_t i, attrib;
+    for (i = 0; i < s->size; ++i) {
+        attrib = Set_next_pos(&iter);
+        Set_copy(&temp, s);
+        Set_remove(&temp, attrib);
+        closure = src_closure(src, &temp);
+        if (closure.set & (1u << attrib)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Propagate decisions of a search node for candidate keys containing
+// in and avoiding out: attributes implied by in are excluded, and
+// attributes without which no super-key remains are included
+static uint8_t propagate(Set *in, Set *out, const closure_src_t *src) {
+    
+    const uint8_t n_attribs = src->n_attribs;
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    if (in->set & out->set) {
+        return NODE_PRUNED;  // contradicting decisions
+    }
+    
+    for (;;) {
+        if (has_redundant_attrib(in, src)) {
+            return NODE_PRUNED;  // in can never be extended to a key
+        }
+        Set closure = src_closure(src, in);
+        if (Set_is_full(&closure, n_attribs)) {
+            // in is a super-key without redundant attributes
+            return NODE_KEY;
+        }
+        // Attributes implied by in are redundant in any extension
+        const Set implied = Set_difference(&closure, in);
+        *out = Set_union(out, &implied);
+        // All remaining attributes must still form a super-key
+        Set allowed = Set_difference(&attribs, out);
+        if (!src_is_superkey(src, &allowed)) {
+            return NODE_PRUNED;
+        }
+        // Free attributes without which no super-key remains are
+        // forced into the key
+        Set free = Set_difference(&allowed, in);
+        Set temp;
+        uint8_t i, attrib, is_forced = 0;
+        for (i = 0; i < free.size; ++i) {
+            attrib = Set_next_pos(&free);
+            Set_copy(&temp, &allowed);
+            Set_remove(&temp, attrib);
+            if (!src_is_superkey(src, &temp)) {
+                Set_insert(in, attrib);
+                is_forced = 1;
+            }
+        }
+        if (!is_forced) {
+            return NODE_OPEN;
+        }
+    }
+}
+
+uint8_t propagate_key_decisions(Set *in, Set *out, const Queue *q,
+    uint8_t n_attribs) {
+    
+    const closure_src_t src = {.q = q, .n_attribs = n_attribs};
+    return propagate(in, out, &src);
+}
+
+uint8_t propagate_key_decisions_with(Set *in, Set *out, uint8_t n_attribs,
+    closure_fn closure, void *arg) {
+    
+    const closure_src_t src = {.n_attribs = n_attribs, .closure = closure,
+                               .arg = arg};
+    return propagate(in, out, &src);
+}
+
+// Lower bound on total weight (size if weights is NULL) of candidate
+// keys containing in and avoiding out. Every closed set C containing in that is not a
+// super-key must be left by the key through an attribute of cut =
+// free \ C. Disjoint cuts are collected by growing C maximally, then
+// adding the cut to it. Stores cheapest attribute of first cut in
+// branch.
+uint64_t key_weight_lower_bound(const Set *in, const Set *out,
+    const Queue *q, uint8_t n_attribs, const uint32_t *weights,
+    uint8_t *branch) {
+    
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    const Set allowed = Set_difference(&attribs, out);
+    const Set free = Set_difference(&allowed, in);
+    uint64_t bound = 0;
+    uint32_t bits = in->set;
+    while (bits) {
+        bound += weights ? weights[__builtin_ctz(bits)] : 1;
+        bits &= bits - 1;
+    }
+    
+    *branch = INVALID_ATTRIB;
+    Set closed = compute_closure(in, q, n_attribs);
+    while (!Set_is_full(&closed, n_attribs)) {
+        // Grow to maximal closed set
+        uint8_t i;
+        for (i = 0; i < n_attribs; ++i) {
+            if (closed.set & (1u << i)) {
+                continue;
+            }
+            Set grown = closed;
+            Set_insert(&grown, i);
+            grown = compute_closure(&grown, q, n_attribs);
+            if (!Set_is_full(&grown, n_attribs)) {
+                closed = grown;
+            }
+        }
+        const Set cut = Set_difference(&free, &closed);
+        assert(cut.size > 0);
+        // Key needs at least the cheapest attribute of cut
+        uint32_t min_weight = UINT32_MAX;
+        bits = cut.set;
+        uint8_t min_attrib = INVALID_ATTRIB;
+        while (bits) {
+            const uint8_t a = (uint8_t) __builtin_ctz(bits);
+            const uint32_t w = weights ? weights[a] : 1;
+            if (w < min_weight) {
+                min_weight = w;
+                min_attrib = a;
+            }
+            bits &= bits - 1;
+        }
+        bound += min_weight;
+        if (*branch == INVALID_ATTRIB) {
+            *branch = min_attrib;
+        }
+        closed = Set_union(&closed, &cut);
+        closed = compute_closure(&closed, q, n_attribs);
+    }
+    return bound;
+}
+
+// Initialize constraints that admit every candidate key
+void key_constraints_init(key_constraints_t *c) {
+    Set_init(&c->include);
+    Set_init(&c->exclude);
+    c->max_size = MAX_ATTRIBS;
+}
+
+// Check if constraints restrict family of candidate keys
+uint8_t key_constraints_active(const key_constraints_t *c) {
+    return c->include.size > 0 || c->exclude.size > 0 ||
+           c->max_size < MAX_ATTRIBS;
+}
+
+// Check if node of key search can still lead to a key satisfying the
+// size constraint (after propagation returned status)
+uint8_t key_constraints_admit(const key_constraints_t *c, const Set *in,
+    uint8_t status) {
+    
+    if (status == NODE_PRUNED) {
+        return 0;
+    }
+    // Open nodes need at least one more attribute
+    return in->size + (status == NODE_OPEN) <= c->max_size;
+}
@@ -11,14 +11,33 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "set.h"
 #include "queue.h"
+#include "fd.h"
+#include "reverse.h"
+#include "zdd.h"
+#include "cdcl.h"
+#include "brute.h"
+#include "prime.h"
+#include "weighted.h"
+#include "control.h"
+#include "checkpoint.h"
+#include "spill.h"
+#include "output.h"
+#include "store.h"
+#include "stats.h"
+#include "perf.h"
+#include "trace.h"
+#include "serve.h"
 
 #define MAX_LINE_LEN 256
 #define DELIM ","
@@ -79,130 +98,76 @@ int8_t parse_attrib_list(char *attrib_list, uint8_t n_attribs,
     return 0;
 }
 
-// Compute closure of a set of attributes for given queues consisting
-// of attributes of left/right sides of all functional dependencies
-Set compute_closure(const Set *s, const Queue *q, uint8_t n_attribs) {
-    // Output
-    Set closure;
-    Set_copy(&closure, s);
-    
-    uint8_t is_new_attrib = 1;
-    while (is_new_attrib) {
-        // Set no new attrib found
-        is_new_attrib = 0;
-        // Iterate through all functional dependencies
-        Q_iterator_t iter = Q_iterator(q);
-        
-        while (iter) {
-            // Check if left-hand side is already contained in closure
-            // while right-side is not
-            if (Set_contains(&closure, &iter->key.lhs) &&
-                !Set_contains(&closure, &iter->key.rhs)) {
-                
-                // Add right-hand side to out
-                closure = Set_union(&closure, &iter->key.rhs);
-                // Check if closure is already full
-                if (Set_is_full(&closure, n_attribs)) {
-                    goto end;  // nothing left to add
-                }
-                // Found new attribute(s)
-                is_new_attrib = 1;
-            }
-            // Advance iterators
-            iter = iter->next;
-        }
-    }
-
-end:
-    return closure;
-}
-
-// Check if set of attributes s is a super-key given functional
-// dependencies in l -> r
-uint8_t is_superkey(const Set *s, const Queue *q, uint8_t n_attribs) {
-    // Output
-    Set closure;
-    Set_copy(&closure, s);
-    
-    uint8_t is_new_attrib = 1;
-    while (is_new_attrib) {
-        // Set no new attrib found
-        is_new_attrib = 0;
-        // Iterate through all functional dependencies
-        Q_iterator_t iter = Q_iterator(q);
-        
-        while (iter) {
-            // Check if left-hand side is already contained in closure
-            // while right-side is not
-            if (Set_contains(&closure, &iter->key.lhs) &&
-                !Set_contains(&closure, &iter->key.rhs)) {
-                
-                // Add right-hand side to out
-                closure = Set_union(&closure, &iter->key.rhs);
-                if (Set_is_full(&closure, n_attribs)) {
-                    return 1;  // Set s is super-key
-                }
-                // Found new attribute(s)
-                is_new_attrib = 1;
-            }
-            // Advance iterators
-            iter = iter->next;
-        }
-    }
-    
-    return 0;
-}
-
-// From paper: Candidate Keys for Relations (journal of computer and
-// system sciences 1978) by Claudio Lucchesi and Sylvia Osborn.
-// Algorithm. Minimal Key (A, D[0], K)
-Set candidate_key_from_super_key(Set *skey, const Queue *q, uint8_t n_attribs) {
-    Set ckey, temp;
-    // Copy attributes
-    Set_copy(&ckey, skey);
-    
-    // Iterate over attributes of super-key
-    uint8_t i, attrib;
-    for (i = 0; i < skey->size; ++i) {
-        // Fetch current attribute
-        attrib = Set_next_pos(skey);
-        // Copy ckey into temp
-        Set_copy(&temp, &ckey);
-        // Remove attribute from temp
-        Set_remove(&temp, attrib);
-        // Check if ckey - attrib is still a super-key
-        if (is_superkey(&temp, q, n_attribs)) {
-            // Attribute attrib is non-essential to ckey -> remove
-            Set_copy(&ckey, &temp);
-        }
-    }
-    return ckey;
+// Seconds on monotonic clock
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + 1e-9 * (double) now.tv_nsec;
 }
 
 // From paper: Candidate Keys for Relations (journal of computer and
 // system sciences 1978) by Claudio Lucchesi and Sylvia Osborn.
 // Algorithm. Set of Minimal Keys (A, D[0])
-void print_all_candidate_keys(const Queue *q, uint8_t n_attribs) {
+// Returns 0 on success, nonzero if checkpoint to resume from is unusable
+// or final state could not be saved
+int8_t print_all_candidate_keys(const Queue *q, uint8_t n_attribs,
+    const checkpoint_config_t *cp) {
     // Queues for ckeys and work left
     Queue ckeys, work;
     Q_init(&ckeys);
     Q_init(&work);
     
-    // Initialize set of all attributes
-    Set attribs;
-    Set_full(&attribs, n_attribs);
-    // Compute first ckey using all attributes
     q_key_t qkey;
-    Set ckey = candidate_key_from_super_key(&attribs, q, n_attribs);
-    // Print first candidate key
-    Set_print(&ckey);
-    // Add this ckey as key element of queue to ckeys and work
-    // Note: These queues only have a lhs
-    qkey = (q_key_t) {.lhs = ckey, .rhs = (Set) {0}};
-    Q_insert(&ckeys, qkey);
-    Q_insert(&work, qkey);
-    // Iterate until no work left (no more candidates to check)
-    while (work.size != 0) {
+    Set ckey;
+    if (cp->resume != NULL) {
+        // Continue from saved state; keys found so far are printed again
+        // so that output of resumed run is complete
+        if (checkpoint_read(cp->resume, q, n_attribs, &ckeys, &work)) {
+            return 1;
+        }
+        Q_iterator_t ckey_iter = Q_iterator(&ckeys);
+        // Keys beyond a (smaller) key limit are not printed again
+        while (ckey_iter && !control_key_found()) {
+            output_key(&ckey_iter->key.lhs);
+            ckey_iter = ckey_iter->next;
+        }
+        fprintf(stderr, "Resumed from '%s' with %u keys and %u work items\n",
+            cp->resume, ckeys.size, work.size);
+    } else {
+        // Initialize set of all attributes
+        Set attribs;
+        Set_full(&attribs, n_attribs);
+        // Compute first ckey using all attributes
+        ckey = candidate_key_from_super_key(&attribs, q, n_attribs);
+        // Print first candidate key
+        output_key(&ckey);
+        control_key_found();
+        // Add this ckey as key element of queue to ckeys and work
+        // Note: These queues only have a lhs
+        qkey = (q_key_t) {.lhs = ckey, .rhs = (Set) {0}};
+        Q_insert(&ckeys, qkey);
+        Q_insert(&work, qkey);
+    }
+    double next_checkpoint = monotonic_seconds() + cp->interval;
+    // Iterate until no work left (no more candidates to check) or run
+    // is stopped by limit or signal
+    // Work items are traced in batches of TRACE_BATCH
+    uint64_t batch = trace_start();
+    uint32_t batch_items = 0;
+    while (work.size != 0 && !control_poll(work.size)) {
+        if (batch_items == TRACE_BATCH) {
+            trace_end("work batch", batch);
+            batch = trace_start();
+            batch_items = 0;
+        }
+        ++batch_items;
+        // Checkpoints are taken between work items only
+        // A failed periodic checkpoint is reported and retried at the
+        // next interval
+        if (cp->path != NULL && monotonic_seconds() >= next_checkpoint) {
+            checkpoint_write(cp->path, q, n_attribs, &ckeys, &work);
+            next_checkpoint = monotonic_seconds() + cp->interval;
+        }
         // Fetch current key from work queue
         const q_key_t key = Q_pop(&work);
         // Iterate over all FDs
@@ -216,13 +181,17 @@ void print_all_candidate_keys(const Queue *q, uint8_t n_attribs) {
             // Compute S
             const Set diff = Set_difference(&key.lhs, &s_right);
             Set S = Set_union(&s_left, &diff);
+            STATS_ADD(s_generated, 1);
             // Test for inclusion of any already found candidate key
             uint8_t test = 1;
+            uint32_t checks = 0;
+            perf_region_begin(PERF_REGION_SCAN);
             // Iterate through all already found candidate keys
             Q_iterator_t ckey_iter = Q_iterator(&ckeys);
             while (ckey_iter) {
                 // Only consider lhs
                 const Set J = ckey_iter->key.lhs;
+                ++checks;
                 // Check for inclusion
                 if (Set_contains(&S, &J)) {
                     test = 0;
@@ -231,8 +200,17 @@ void print_all_candidate_keys(const Queue *q, uint8_t n_attribs) {
                 // Advance
                 ckey_iter = ckey_iter->next;
             }
+            perf_region_end(PERF_REGION_SCAN);
+            STATS_ADD(containment_checks, checks);
+            STATS_ADD(s_rejected, !test);
             
             if (test) {
+                if (control_key_found()) {
+                    // Item was not finished; keys it still yields are
+                    // found again when it is processed after resuming
+                    Q_insert(&work, key);
+                    break;
+                }
                 // Set S is a super-key and does not contain any already
                 // found candidate keys -> compute new candidate key
                 ckey = candidate_key_from_super_key(&S, q, n_attribs);
@@ -241,27 +219,591 @@ void print_all_candidate_keys(const Queue *q, uint8_t n_attribs) {
                 Q_insert(&ckeys, qkey);
                 Q_insert(&work, qkey);
                 // Print candidate key
-                Set_print(&ckey);
+                output_key(&ckey);
             }
             // Advance iterators
             iter = iter->next;
         }
     }
+    if (batch_items > 0) {
+        trace_end("work batch", batch);
+    }
+    // Save final state so that a stopped run can be resumed
+    int8_t ierr = 0;
+    if (cp->path != NULL &&
+        checkpoint_write(cp->path, q, n_attribs, &ckeys, &work)) {
+        fprintf(stderr, "Final state was not saved; the run cannot be "
+            "resumed from '%s'\n", cp->path);
+        ierr = 1;
+    }
     // Print number of candidate keys found
+    output_flush();
     printf("Number of candidate keys: %u\n", ckeys.size);
     // Cleanup
     Q_free(&ckeys);
     Q_free(&work);
+    return ierr;
+}
+
+// Parse attribute weights of form "A=4, B=8"; attributes not listed
+// keep their weight
+int8_t parse_weights(char *weight_list, uint8_t n_attribs,
+    uint32_t weights[MAX_ATTRIBS]) {
+    
+    char *save_weight;
+    char *item = strtok_r(weight_list, DELIM, &save_weight);
+    while (item != NULL) {
+        char *iter = item;
+        while (*iter == ' ') {
+            ++iter;
+        }
+        char *end;
+        const char c = *iter;
+        if (!is_valid_attrib(c) || (uint8_t)(c - 'A') >= n_attribs ||
+            iter[1] != '=') {
+            fprintf(stderr, "Invalid weight '%s': Expected <attribute>=<weight> "
+                "with attributes from A to %c\n", item, (char)('A' + (n_attribs-1)));
+            return 1;
+        }
+        const unsigned long w = strtoul(iter + 2, &end, 10);
+        if (end == iter + 2 || w > UINT32_MAX) {
+            fprintf(stderr, "Invalid weight '%s'\n", item);
+            return 1;
+        }
+        weights[c - 'A'] = (uint32_t) w;
+        item = strtok_r(NULL, DELIM, &save_weight);
+    }
+    return 0;
+}
+
+// Build family of candidate keys as ZDD and report its size, the
+// number of super-keys and how often each attribute occurs in a key.
+// Keys are printed lazily from the diagram unless count_only is set.
+void print_candidate_keys_zdd(const Queue *q, uint8_t n_attribs,
+    uint8_t count_only, const Set *member) {
+    
+    Zdd z;
+    Zdd_init(&z);
+    const zdd_t ckeys = Zdd_candidate_keys(&z, q, n_attribs);
+    
+    if (!count_only) {
+        Zdd_iterator it;
+        Zdd_iterator_init(&it, &z, ckeys);
+        Set ckey;
+        while (Zdd_iterator_next(&it, &ckey)) {
+            output_key(&ckey);
+        }
+    }
+    output_flush();
+    const zdd_t skeys = Zdd_supersets(&z, ckeys, n_attribs);
+    printf("Number of candidate keys: %lu\n", (unsigned long) Zdd_count(&z, ckeys));
+    printf("Number of super-keys: %lu\n", (unsigned long) Zdd_count(&z, skeys));
+    printf("Candidate keys containing attribute:\n");
+    uint8_t i;
+    for (i = 0; i < n_attribs; ++i) {
+        const zdd_t with = Zdd_onset(&z, ckeys, i);
+        printf("%c: %lu\n", (char)(i + 'A'), (unsigned long) Zdd_count(&z, with));
+    }
+    if (member != NULL) {
+        Set m;
+        Set_copy(&m, member);
+        const char *kind = Zdd_contains(&z, ckeys, &m) ? "candidate key" :
+                           Zdd_contains(&z, skeys, &m) ? "super-key" : "no key";
+        printf("Membership of ");
+        for (i = 0; i < m.size; ++i) {
+            printf("%c ", (char)(Set_next_pos(&m) + 'A'));
+        }
+        printf("-> %s\n", kind);
+    }
+    printf("Number of ZDD nodes: %u\n", z.size);
+    Zdd_free(&z);
+}
+
+// Answer key queries with CDCL solver instead of enumerating all keys
+void print_key_queries_cdcl(const Queue *q, uint8_t n_attribs,
+    int16_t key_size, uint8_t prime_attrib) {
+    
+    Set key;
+    uint8_t answer;
+    if (key_size >= 0) {
+        answer = cdcl_has_key_of_size(q, n_attribs, (uint8_t) key_size, &key);
+        if (answer == CDCL_UNKNOWN) {
+            printf("Unknown if candidate key with at most %d attributes exists\n",
+                key_size);
+        } else if (answer) {
+            printf("Candidate key with at most %d attributes: ", key_size);
+            Set_print(&key);
+        } else {
+            printf("No candidate key with at most %d attributes\n", key_size);
+        }
+    }
+    if (prime_attrib != INVALID_ATTRIB) {
+        answer = cdcl_is_prime(q, n_attribs, prime_attrib, &key);
+        if (answer == CDCL_UNKNOWN) {
+            printf("Unknown if attribute %c is prime\n", (char)(prime_attrib + 'A'));
+        } else if (answer) {
+            printf("Attribute %c is prime, e.g. in key: ",
+                (char)(prime_attrib + 'A'));
+            Set_print(&key);
+        } else {
+            printf("Attribute %c is not prime\n", (char)(prime_attrib + 'A'));
+        }
+    }
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <functional dependecy file>\n"
+        "Options:\n"
+        "  -e, --engine <name>   key enumeration engine: lo (default), reverse, zdd,\n"
+        "                        cdcl, brute (reference, at most 20 attributes)\n"
+        "  -j, --threads <n>     number of worker threads (reverse, primes)\n"
+        "  -c, --count-only      only print counts, not the keys (zdd engine)\n"
+        "  -m, --member <attrs>  test if e.g. 'A,B' is a key (zdd engine)\n"
+        "  -k, --key-size <k>    only check for a key of at most k attributes (cdcl)\n"
+        "  -p, --prime <attr>    only check if attribute is prime (cdcl)\n"
+        "  -a, --primes          only compute all prime attributes\n"
+        "  -w, --weights <list>  find cheapest key for weights e.g. 'A=8,B=4'\n"
+        "                        (unlisted attributes weigh 1)\n"
+        "  -t, --top <k>         find k cheapest keys (default 1)\n"
+        "  -r, --ranked          list keys smallest first\n"
+        "  -f, --first <k>       stop ranked listing after k keys\n"
+        "Constraints (enforced by reverse, brute, ranked and weighted search; select\n"
+        "the reverse engine unless -e names another; not allowed with -a, -k, -p):\n"
+        "  -i, --include <attrs> only keys containing all of e.g. 'A,B'\n"
+        "  -x, --exclude <attrs> only keys containing none of e.g. 'C,D'\n"
+        "  -s, --max-size <s>    only keys of at most s attributes\n"
+        "Run control:\n"
+        "  -T, --time-limit <s>  stop after s seconds, marking output as partial\n"
+        "  -K, --max-keys <n>    stop after n keys, marking output as partial\n"
+        "  -P, --progress <s>    report progress on stderr every s seconds\n"
+        "  -C, --checkpoint <f>  save lo engine state to file f periodically\n"
+        "  -I, --checkpoint-interval <s>\n"
+        "                        seconds between checkpoints (default 60)\n"
+        "  -R, --resume <f>      continue lo engine run from checkpoint f\n"
+        "  -M, --memory <MiB>    keep lo engine within memory budget, spilling\n"
+        "                        work queue and keys to disk\n"
+        "  -D, --spill-dir <d>   directory for spill files (default $TMPDIR or /tmp)\n"
+        "      --spill-min-buffer <n>\n"
+        "                        smallest spill buffers in keys, even below the\n"
+        "                        memory budget (default 1024)\n"
+        "  -F, --format <fmt>    key format: text (default), ndjson, csv, hex or\n"
+        "                        binary (32 bit little endian masks)\n"
+        "  -o, --output <f>      write keys to file f instead of stdout\n"
+        "  -W, --writer-thread   write keys on a separate thread\n"
+        "  -S, --store <f>       also write keys to result file f for queries\n"
+        "      --stats           report time per phase and operation counts on stderr\n"
+        "      --perf            report hardware counters per phase on stderr\n"
+        "      --trace <f>       write timeline of run as Chrome trace JSON to f\n"
+        "\n"
+        "Usage: %s query [options] <result file>\n"
+        "  -k, --key <i>         print key number i (from 0)\n"
+        "  -i, --include <attrs> keys containing all attributes, e.g. A,B\n"
+        "  -x, --exclude <attrs> keys containing none of the attributes\n"
+        "  -c, --count-only      only print number of matching keys\n"
+        "  Without options, prints key count per attribute.\n"
+        "\n"
+        "Usage: %s serve [options] <socket path>\n"
+        "  Answer requests on FD sets kept in memory (see README).\n",
+        prog, prog, prog);
+}
+
+// Answer queries on a result file without enumerating keys again
+int query_main(int argc, char *argv[], const char *prog) {
+    long key_index = -1;
+    uint8_t count_only = 0;
+    char *include_list = NULL, *exclude_list = NULL;
+    static const struct option long_options[] = {
+        {"key",        required_argument, NULL, 'k'},
+        {"include",    required_argument, NULL, 'i'},
+        {"exclude",    required_argument, NULL, 'x'},
+        {"count-only", no_argument,       NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:i:x:c", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'k': {
+                char *end;
+                errno = 0;
+                key_index = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || errno != 0 ||
+                    key_index < 0) {
+                    fprintf(stderr, "Invalid key number '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'i':
+                include_list = optarg;
+                break;
+            case 'x':
+                exclude_list = optarg;
+                break;
+            case 'c':
+                count_only = 1;
+                break;
+            default:
+                print_usage(prog);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(prog);
+        return EXIT_FAILURE;
+    }
+    store_t st;
+    if (store_map(&st, argv[optind])) {
+        return EXIT_FAILURE;
+    }
+    const uint8_t n_attribs = (uint8_t) st.header->n_attribs;
+    const uint64_t n_keys = st.header->n_keys;
+    const uint64_t n_words = st.header->posting_words;
+    char *save_attrib;
+    Set include, exclude;
+    Set_init(&include);
+    Set_init(&exclude);
+    if ((include_list != NULL && parse_attrib_list(include_list, n_attribs,
+            &save_attrib, &include)) ||
+        (exclude_list != NULL && parse_attrib_list(exclude_list, n_attribs,
+            &save_attrib, &exclude))) {
+        store_unmap(&st);
+        return EXIT_FAILURE;
+    }
+    const double start = monotonic_seconds();
+    uint64_t i, w;
+    uint8_t a;
+    if (key_index >= 0) {
+        if ((uint64_t) key_index >= n_keys) {
+            fprintf(stderr, "Key number %ld out of range: %lu keys\n",
+                key_index, (unsigned long) n_keys);
+            store_unmap(&st);
+            return EXIT_FAILURE;
+        }
+        Set key;
+        Set_init(&key);
+        key.set = st.masks[key_index];
+        key.size = (uint8_t) __builtin_popcount(key.set);
+        printf("Key %ld: ", key_index);
+        Set_print(&key);
+    } else if (include_list == NULL && exclude_list == NULL) {
+        printf("Number of attributes: %u\n", n_attribs);
+        printf("Number of candidate keys: %lu\n", (unsigned long) n_keys);
+        printf("Candidate keys containing attribute:\n");
+        for (a = 0; a < n_attribs; ++a) {
+            const uint64_t *posting = store_posting(&st, a);
+            uint64_t count = 0;
+            for (w = 0; w < n_words; ++w) {
+                count += (uint64_t) __builtin_popcountll(posting[w]);
+            }
+            printf("%c: %lu\n", (char)(a + 'A'), (unsigned long) count);
+        }
+    } else {
+        // Intersect posting bitmaps word by word; no key both contains
+        // and avoids an attribute
+        uint64_t n_matches = 0;
+        const uint64_t scan_words = include.set & exclude.set ? 0 : n_words;
+        for (w = 0; w < scan_words; ++w) {
+            uint64_t bits = w + 1 < n_words || n_keys % 64 == 0 ?
+                ~0ull : (1ull << (n_keys % 64)) - 1;
+            for (a = 0; a < n_attribs && bits; ++a) {
+                if ((include.set >> a) & 1) {
+                    bits &= store_posting(&st, a)[w];
+                } else if ((exclude.set >> a) & 1) {
+                    bits &= ~store_posting(&st, a)[w];
+                }
+            }
+            n_matches += (uint64_t) __builtin_popcountll(bits);
+            while (bits && !count_only) {
+                i = w * 64 + (uint64_t) __builtin_ctzll(bits);
+                Set key;
+                Set_init(&key);
+                key.set = st.masks[i];
+                key.size = (uint8_t) __builtin_popcount(key.set);
+                printf("%lu: ", (unsigned long) i);
+                Set_print(&key);
+                bits &= bits - 1;
+            }
+        }
+        printf("Number of matching keys: %lu\n", (unsigned long) n_matches);
+    }
+    printf("Query took: %.1f us\n", 1e6 * (monotonic_seconds() - start));
+    store_unmap(&st);
+    return EXIT_SUCCESS;
 }
 
 int main(int argc, char *argv[]) {
     
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <functional dependecy file>\n", argv[0]);
+    if (argc > 1 && strcmp(argv[1], "query") == 0) {
+        return query_main(argc - 1, argv + 1, argv[0]);
+    }
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+        return serve_main(argc - 1, argv + 1, argv[0]);
+    }
+    enum { ENGINE_LO, ENGINE_REVERSE, ENGINE_ZDD, ENGINE_CDCL,
+           ENGINE_BRUTE } engine = ENGINE_LO;
+    uint8_t engine_given = 0;
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t count_only = 0;
+    char *member_list = NULL;
+    int16_t key_size = -1;
+    char prime_name = '\0';
+    uint8_t primes_only = 0;
+    char *weight_list = NULL;
+    long top_k = 0;
+    uint8_t ranked = 0;
+    long first_k = 0, max_size = MAX_ATTRIBS;
+    char *include_list = NULL, *exclude_list = NULL;
+    double time_limit = 0.0, progress_interval = 0.0;
+    long max_keys = 0;
+    checkpoint_config_t checkpoint = {.path = NULL, .interval = 60.0,
+                                      .resume = NULL};
+    double memory_mib = 0.0;
+    const char *spill_dir = getenv("TMPDIR");
+    uint32_t spill_min_buffer = SPILL_MIN_BUFFER;
+    uint8_t key_format = OUTPUT_TEXT, writer_thread = 0;
+    const char *output_path = NULL, *store_path = NULL;
+    uint8_t show_stats = 0, show_perf = 0;
+    const char *trace_path = NULL;
+    // Options without short form
+    enum { OPT_STATS = 256, OPT_PERF, OPT_TRACE, OPT_SPILL_MIN_BUFFER };
+    
+    static const struct option long_options[] = {
+        {"engine",     required_argument, NULL, 'e'},
+        {"threads",    required_argument, NULL, 'j'},
+        {"count-only", no_argument,       NULL, 'c'},
+        {"member",     required_argument, NULL, 'm'},
+        {"key-size",   required_argument, NULL, 'k'},
+        {"prime",      required_argument, NULL, 'p'},
+        {"primes",     no_argument,       NULL, 'a'},
+        {"weights",    required_argument, NULL, 'w'},
+        {"top",        required_argument, NULL, 't'},
+        {"ranked",     no_argument,       NULL, 'r'},
+        {"first",      required_argument, NULL, 'f'},
+        {"max-size",   required_argument, NULL, 's'},
+        {"include",    required_argument, NULL, 'i'},
+        {"exclude",    required_argument, NULL, 'x'},
+        {"time-limit", required_argument, NULL, 'T'},
+        {"max-keys",   required_argument, NULL, 'K'},
+        {"progress",   required_argument, NULL, 'P'},
+        {"checkpoint", required_argument, NULL, 'C'},
+        {"checkpoint-interval", required_argument, NULL, 'I'},
+        {"resume",     required_argument, NULL, 'R'},
+        {"memory",     required_argument, NULL, 'M'},
+        {"spill-dir",  required_argument, NULL, 'D'},
+        {"spill-min-buffer", required_argument, NULL, OPT_SPILL_MIN_BUFFER},
+        {"format",     required_argument, NULL, 'F'},
+        {"output",     required_argument, NULL, 'o'},
+        {"writer-thread", no_argument,    NULL, 'W'},
+        {"store",      required_argument, NULL, 'S'},
+        {"stats",      no_argument,       NULL, OPT_STATS},
+        {"perf",       no_argument,       NULL, OPT_PERF},
+        {"trace",      required_argument, NULL, OPT_TRACE},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "e:j:cm:k:p:aw:t:rf:s:i:x:T:K:P:C:I:R:M:D:F:o:WS:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                engine_given = 1;
+                if (strcmp(optarg, "lo") == 0) {
+                    engine = ENGINE_LO;
+                } else if (strcmp(optarg, "reverse") == 0) {
+                    engine = ENGINE_REVERSE;
+                } else if (strcmp(optarg, "zdd") == 0) {
+                    engine = ENGINE_ZDD;
+                } else if (strcmp(optarg, "cdcl") == 0) {
+                    engine = ENGINE_CDCL;
+                } else if (strcmp(optarg, "brute") == 0) {
+                    engine = ENGINE_BRUTE;
+                } else {
+                    fprintf(stderr, "Unknown engine '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'j':
+                n_threads = strtol(optarg, NULL, 10);
+                if (n_threads <= 0) {
+                    fprintf(stderr, "Invalid thread count '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                count_only = 1;
+                break;
+            case 'm':
+                member_list = optarg;
+                break;
+            case 'k': {
+                const long size = strtol(optarg, NULL, 10);
+                if (size < 0 || size > MAX_ATTRIBS) {
+                    fprintf(stderr, "Invalid key size '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                key_size = (int16_t) size;
+                break;
+            }
+            case 'p':
+                prime_name = optarg[0];
+                if (!is_valid_attrib(prime_name) || optarg[1] != '\0') {
+                    fprintf(stderr, "Invalid attribute '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'a':
+                primes_only = 1;
+                break;
+            case 'w':
+                weight_list = optarg;
+                break;
+            case 't':
+                top_k = strtol(optarg, NULL, 10);
+                if (top_k <= 0) {
+                    fprintf(stderr, "Invalid number of keys '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r':
+                ranked = 1;
+                break;
+            case 'f':
+                first_k = strtol(optarg, NULL, 10);
+                if (first_k <= 0) {
+                    fprintf(stderr, "Invalid number of keys '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                ranked = 1;
+                break;
+            case 's':
+                max_size = strtol(optarg, NULL, 10);
+                if (max_size <= 0) {
+                    fprintf(stderr, "Invalid key size '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'i':
+                include_list = optarg;
+                break;
+            case 'x':
+                exclude_list = optarg;
+                break;
+            case 'T':
+                time_limit = strtod(optarg, NULL);
+                if (time_limit <= 0.0) {
+                    fprintf(stderr, "Invalid time limit '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'K':
+                max_keys = strtol(optarg, NULL, 10);
+                if (max_keys <= 0) {
+                    fprintf(stderr, "Invalid number of keys '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'P':
+                progress_interval = strtod(optarg, NULL);
+                if (progress_interval <= 0.0) {
+                    fprintf(stderr, "Invalid progress interval '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'C':
+                checkpoint.path = optarg;
+                break;
+            case 'I':
+                checkpoint.interval = strtod(optarg, NULL);
+                if (checkpoint.interval <= 0.0) {
+                    fprintf(stderr, "Invalid checkpoint interval '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'R':
+                checkpoint.resume = optarg;
+                break;
+            case 'M':
+                memory_mib = strtod(optarg, NULL);
+                if (memory_mib <= 0.0) {
+                    fprintf(stderr, "Invalid memory budget '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'D':
+                spill_dir = optarg;
+                break;
+            case OPT_SPILL_MIN_BUFFER: {
+                char *end;
+                errno = 0;
+                const long n = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || errno != 0 || n < 1 ||
+                    n > (long) SPILL_MIN_BUFFER) {
+                    fprintf(stderr, "Invalid spill buffer size '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                spill_min_buffer = (uint32_t) n;
+                break;
+            }
+            case 'F':
+                key_format = output_format(optarg);
+                if (key_format == OUTPUT_INVALID) {
+                    fprintf(stderr, "Unknown key format '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'W':
+                writer_thread = 1;
+                break;
+            case 'S':
+                store_path = optarg;
+                break;
+            case OPT_STATS:
+                show_stats = 1;
+                stats_enabled = 1;
+                break;
+            case OPT_PERF:
+                show_perf = 1;
+                break;
+            case OPT_TRACE:
+                trace_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (n_threads <= 0) {
+        n_threads = 1;
+    }
+    // Prime attribute and key queries print reports, not key streams
+    if ((primes_only || key_size >= 0 || prime_name != '\0') &&
+        (key_format != OUTPUT_TEXT || output_path != NULL || writer_thread ||
+         store_path != NULL)) {
+        fprintf(stderr, "Options -F, -o, -W and -S cannot be combined with "
+            "-a, -k or -p\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (optind >= argc) {
+        print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    const char *file_name = argv[1];
+    const char *file_name = argv[optind];
+    // Keys go through buffered writer; done before anything is printed
+    // as it may move other output to stderr
+    if (output_init(key_format, output_path, writer_thread)) {
+        exit(EXIT_FAILURE);
+    }
+    // Counters and tracing must be set up before first phase starts
+    if (show_perf) {
+        perf_init();
+    }
+    if (trace_path != NULL) {
+        trace_init(trace_path);
+    }
+    stats_phase_begin(STATS_PARSE);
     // Open file containing information about functional dependencies
     FILE *fp = fopen(file_name, "r");
     // Check for error while opening file
@@ -343,18 +885,182 @@ int main(int argc, char *argv[]) {
     }
     // Close file
     fclose(fp);
+    stats_phase_end(STATS_PARSE);
+    stats_phase_begin(STATS_PREPROCESS);
+    // Parse attributes to test for membership in key family
+    Set member;
+    if (member_list != NULL) {
+        if (parse_attrib_list(member_list, n_attribs, &save_attrib, &member)) {
+            Q_free(&q);
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint8_t prime_attrib = INVALID_ATTRIB;
+    if (prime_name != '\0') {
+        prime_attrib = (uint8_t)(prime_name - 'A');
+        if (prime_attrib >= n_attribs) {
+            fprintf(stderr, "Invalid attribute %c: Expected "
+                "attributes from A to %c\n",
+                    prime_name, (char)('A' + (n_attribs-1)));
+            Q_free(&q);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (key_size > n_attribs) {
+        fprintf(stderr, "Invalid key size %d: Expected at most %u "
+            "attributes\n", key_size, n_attribs);
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    // Constraints on keys to enumerate
+    key_constraints_t constraints;
+    key_constraints_init(&constraints);
+    if (max_size < MAX_ATTRIBS) {
+        constraints.max_size = (uint8_t) max_size;
+    }
+    if ((include_list != NULL && parse_attrib_list(include_list, n_attribs,
+            &save_attrib, &constraints.include)) ||
+        (exclude_list != NULL && parse_attrib_list(exclude_list, n_attribs,
+            &save_attrib, &constraints.exclude))) {
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    // Prime attribute and key queries answer for all candidate keys;
+    // answers for a constrained family would be wrong, not just slower
+    if (key_constraints_active(&constraints) &&
+        (primes_only || key_size >= 0 || prime_attrib != INVALID_ATTRIB)) {
+        fprintf(stderr, "Constraints (-i, -x, -s) cannot be combined with "
+            "-a, -k or -p\n");
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    // Weighted search is requested by weights or number of keys
+    const uint8_t weighted = weight_list != NULL || top_k > 0;
+    if (key_constraints_active(&constraints) && engine != ENGINE_REVERSE &&
+        engine != ENGINE_BRUTE && !ranked && !weighted) {
+        // Lucchesi-Osborn neighbours of keys satisfying constraints may
+        // only be reachable through keys violating them
+        if (engine_given) {
+            fprintf(stderr, "Constraints (-i, -x, -s) require the reverse "
+                "or brute engine\n");
+            Q_free(&q);
+            exit(EXIT_FAILURE);
+        }
+        engine = ENGINE_REVERSE;
+    }
+    uint32_t weights[MAX_ATTRIBS];
+    uint8_t i;
+    for (i = 0; i < MAX_ATTRIBS; ++i) {
+        weights[i] = 1;
+    }
+    if (weight_list != NULL && parse_weights(weight_list, n_attribs, weights)) {
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    if (top_k <= 0) {
+        top_k = 1;
+    }
+    // Only the Lucchesi-Osborn enumeration keeps resumable state or
+    // spills to disk
+    const uint8_t plain_lo = engine == ENGINE_LO && !primes_only &&
+        !weighted && !ranked && key_size < 0 && prime_attrib == INVALID_ATTRIB;
+    if ((checkpoint.path != NULL || checkpoint.resume != NULL) && !plain_lo) {
+        fprintf(stderr, "Checkpoints require plain enumeration with the "
+            "lo engine\n");
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    if (memory_mib > 0.0 && (!plain_lo || checkpoint.path != NULL ||
+                             checkpoint.resume != NULL)) {
+        fprintf(stderr, "Memory budget requires plain enumeration with the "
+            "lo engine and no checkpoints\n");
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    if (spill_dir == NULL) {
+        spill_dir = "/tmp";
+    }
     // Print closure of attributes from command line
     //print_attribute_closure(&g, &attrib_cml, visited_buf, 
     //    visited_thresh, n_attribs);
-    printf("Candidate keys for FDs in '%s':\n", file_name);
-    // Measure CPU time
+    if (primes_only) {
+        printf("Prime attributes for FDs in '%s':\n", file_name);
+    } else if (weighted) {
+        printf("Cheapest candidate keys for FDs in '%s':\n", file_name);
+    } else if (ranked) {
+        printf("Candidate keys by size for FDs in '%s':\n", file_name);
+    } else if (key_size >= 0 || prime_attrib != INVALID_ATTRIB) {
+        printf("Key queries for FDs in '%s':\n", file_name);
+    } else {
+        printf("Candidate keys for FDs in '%s':\n", file_name);
+    }
+    if (store_path != NULL) {
+        store_begin(store_path, n_attribs);
+    }
+    // Limits and progress reports apply from here on
+    control_init(time_limit, (uint64_t) max_keys, progress_interval);
+    control_install_signals();
+    stats_phase_end(STATS_PREPROCESS);
+    stats_phase_begin(STATS_ENUMERATE);
+    // Measure CPU time (summed over all worker threads)
     clock_t start = clock(), elapsed;
     // Print all candidate keys of functional dependencies to console
-    print_all_candidate_keys(&q, n_attribs);
+    if (primes_only) {
+        print_prime_attribs(&q, n_attribs, (uint32_t) n_threads);
+    } else if (weighted) {
+        print_min_weight_keys(&q, n_attribs, weights, &constraints,
+            (uint32_t) top_k);
+    } else if (ranked) {
+        print_keys_ranked(&q, n_attribs, &constraints, (uint32_t) first_k);
+    } else if (key_size >= 0 || prime_attrib != INVALID_ATTRIB) {
+        print_key_queries_cdcl(&q, n_attribs, key_size, prime_attrib);
+    } else if (engine == ENGINE_REVERSE) {
+        print_all_candidate_keys_reverse(&q, n_attribs, &constraints,
+            (uint32_t) n_threads);
+    } else if (engine == ENGINE_ZDD) {
+        print_candidate_keys_zdd(&q, n_attribs, count_only,
+            member_list != NULL ? &member : NULL);
+    } else if (engine == ENGINE_CDCL) {
+        print_all_candidate_keys_cdcl(&q, n_attribs);
+    } else if (engine == ENGINE_BRUTE) {
+        if (print_all_candidate_keys_brute(&q, n_attribs, &constraints)) {
+            Q_free(&q);
+            exit(EXIT_FAILURE);
+        }
+    } else if (memory_mib > 0.0) {
+        if (print_all_candidate_keys_spill(&q, n_attribs,
+                (uint64_t) (memory_mib * 1024.0 * 1024.0), spill_min_buffer,
+                spill_dir)) {
+            Q_free(&q);
+            exit(EXIT_FAILURE);
+        }
+    } else if (print_all_candidate_keys(&q, n_attribs, &checkpoint)) {
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
     // Elapsed CPU time
     elapsed = clock() - start;
+    stats_phase_end(STATS_ENUMERATE);
+    control_report();
     const double seconds = (double)elapsed / CLOCKS_PER_SEC;
     printf("Took: %.3e s\n", seconds);
+    output_close();
+    stats_phase_begin(STATS_OUTPUT);
+    if (store_end()) {
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
+    stats_phase_end(STATS_OUTPUT);
+    if (show_stats) {
+        stats_report();
+    }
+    if (show_perf) {
+        perf_report();
+    }
+    if (trace_write()) {
+        Q_free(&q);
+        exit(EXIT_FAILURE);
+    }
     // Cleanup queue
     Q_free(&q);
     
@@ -0,0 +1,461 @@
+#include "funcdep.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FD set: Queue as used by the closure kernels, with its nodes in one
+// array that is linked in insertion order
+struct funcdep {
+    uint8_t n_attribs;
+    Queue q;
+    struct q_node_t *nodes;
+    uint32_t cap;
+};
+
+// Found keys in order of discovery. Lucchesi-Osborn processes keys in
+// the same order, so keys[next..] doubles as work queue.
+struct funcdep_ws {
+    uint32_t *keys;
+    uint32_t n_keys;
+    uint32_t cap;
+};
+
+static const char *messages[] = {
+    [FUNCDEP_OK]         = "success",
+    [FUNCDEP_ERR_ARG]    = "invalid argument",
+    [FUNCDEP_ERR_ATTRIB] = "attribute outside of FD set",
+    [FUNCDEP_ERR_PARSE]  = "malformed functional dependency",
+    [FUNCDEP_ERR_IO]     = "could not read file",
+    [FUNCDEP_ERR_NOMEM]  = "out of memory",
+    [FUNCDEP_STOPPED]    = "stopped by callback",
+    [FUNCDEP_DONE]       = "no more keys"
+};
+
+// Description of error code
+const char *funcdep_strerror(int8_t err) {
+    if (err < 0 || err > FUNCDEP_DONE) {
+        return "unknown error";
+    }
+    return messages[err];
+}
+
+static Set set_from_mask(uint32_t mask) {
+    Set s;
+    Set_init(&s);
+    s.set = mask;
+    s.size = (uint8_t) __builtin_popcount(mask);
+    return s;
+}
+
+static uint32_t all_attribs(const funcdep_t *fd) {
+    return (uint32_t)((1ull << fd->n_attribs) - 1);
+}
+
+// Create empty FD set over n_attribs attributes
+int8_t funcdep_create(uint8_t n_attribs, funcdep_t **out) {
+    if (out == NULL || n_attribs == 0 || n_attribs > FUNCDEP_MAX_ATTRIBS) {
+        return FUNCDEP_ERR_ARG;
+    }
+    funcdep_t *fd = (funcdep_t *) calloc(1, sizeof(funcdep_t));
+    if (fd == NULL) {
+        return FUNCDEP_ERR_NOMEM;
+    }
+    fd->n_attribs = n_attribs;
+    Q_init(&fd->q);
+    *out = fd;
+    return FUNCDEP_OK;
+}
+
+// Add FD lhs -> rhs (both non-empty)
+int8_t funcdep_add(funcdep_t *fd, uint32_t lhs, uint32_t rhs) {
+    if (fd == NULL || lhs == 0 || rhs == 0) {
+        return FUNCDEP_ERR_ARG;
+    }
+    if ((lhs | rhs) & ~all_attribs(fd)) {
+        return FUNCDEP_ERR_ATTRIB;
+    }
+    const uint32_t n = fd->q.size;
+    if (n == fd->cap) {
+        const uint32_t cap = fd->cap ? 2 * fd->cap : 16;
+        struct q_node_t *nodes = (struct q_node_t *) realloc(fd->nodes,
+            cap * sizeof(struct q_node_t));
+        if (nodes == NULL) {
+            return FUNCDEP_ERR_NOMEM;
+        }
+        // Nodes moved: link them again
+        uint32_t i;
+        for (i = 0; i + 1 < n; ++i) {
+            nodes[i].next = &nodes[i + 1];
+        }
+        fd->nodes = nodes;
+        fd->cap = cap;
+    }
+    struct q_node_t *node = &fd->nodes[n];
+    node->key = (q_key_t) {.lhs = set_from_mask(lhs),
+                           .rhs = set_from_mask(rhs)};
+    node->next = NULL;
+    if (n > 0) {
+        fd->nodes[n - 1].next = node;
+    }
+    // Iteration starts at tail (oldest FD)
+    fd->q.tail = &fd->nodes[0];
+    fd->q.head = node;
+    fd->q.size = n + 1;
+    return FUNCDEP_OK;
+}
+
+// Parse comma separated attributes in [begin, end), e.g. " A, B"
+static int8_t parse_side(const char *begin, const char *end, uint8_t n_attribs,
+    uint32_t *mask) {
+    *mask = 0;
+    uint8_t expect_attrib = 1;
+    const char *c;
+    for (c = begin; c < end; ++c) {
+        if (*c == ' ' || *c == '\t' || *c == '\r') {
+            continue;
+        }
+        if (expect_attrib && 'A' <= *c && *c <= 'Z') {
+            if (*c - 'A' >= n_attribs) {
+                return FUNCDEP_ERR_ATTRIB;
+            }
+            *mask |= 1u << (*c - 'A');
+            expect_attrib = 0;
+        } else if (!expect_attrib && *c == ',') {
+            expect_attrib = 1;
+        } else {
+            return FUNCDEP_ERR_PARSE;
+        }
+    }
+    return expect_attrib ? FUNCDEP_ERR_PARSE : FUNCDEP_OK;
+}
+
+static uint8_t is_blank(const char *begin, const char *end) {
+    for (; begin < end; ++begin) {
+        if (*begin != ' ' && *begin != '\t' && *begin != '\r') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Create FD set from text in the input format of func_dep
+int8_t funcdep_parse(const char *text, funcdep_t **out, uint32_t *err_line) {
+    if (text == NULL || out == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    uint32_t line_num = 1;
+    char *end;
+    const long n = strtol(text, &end, 10);
+    if (end == text || n <= 0 || n > FUNCDEP_MAX_ATTRIBS) {
+        if (err_line != NULL) {
+            *err_line = line_num;
+        }
+        return end == text ? FUNCDEP_ERR_PARSE : FUNCDEP_ERR_ARG;
+    }
+    funcdep_t *fd;
+    int8_t err = funcdep_create((uint8_t) n, &fd);
+    if (err) {
+        return err;
+    }
+    const char *line = strchr(end, '\n');
+    while (line != NULL && err == FUNCDEP_OK) {
+        ++line;
+        ++line_num;
+        const char *line_end = strchr(line, '\n');
+        if (line_end == NULL) {
+            line_end = line + strlen(line);
+        }
+        if (!is_blank(line, line_end)) {
+            const char *arrow = strstr(line, "->");
+            uint32_t lhs, rhs;
+            if (arrow == NULL || arrow >= line_end) {
+                err = FUNCDEP_ERR_PARSE;
+            } else if (!(err = parse_side(line, arrow, fd->n_attribs, &lhs)) &&
+                       !(err = parse_side(arrow + 2, line_end, fd->n_attribs,
+                                          &rhs))) {
+                err = funcdep_add(fd, lhs, rhs);
+            }
+        }
+        line = *line_end == '\n' ? line_end : NULL;
+    }
+    if (err) {
+        if (err_line != NULL) {
+            *err_line = line_num;
+        }
+        funcdep_free(fd);
+        return err;
+    }
+    *out = fd;
+    return FUNCDEP_OK;
+}
+
+// Create FD set from file in the input format of func_dep
+int8_t funcdep_load(const char *path, funcdep_t **out, uint32_t *err_line) {
+    if (path == NULL || out == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return FUNCDEP_ERR_IO;
+    }
+    size_t len = 0, cap = 4096;
+    char *text = (char *) malloc(cap);
+    int8_t err = text == NULL ? FUNCDEP_ERR_NOMEM : FUNCDEP_OK;
+    while (!err) {
+        len += fread(text + len, 1, cap - len - 1, fp);
+        if (len < cap - 1) {
+            break;
+        }
+        cap *= 2;
+        char *grown = (char *) realloc(text, cap);
+        if (grown == NULL) {
+            err = FUNCDEP_ERR_NOMEM;
+        } else {
+            text = grown;
+        }
+    }
+    if (!err && ferror(fp)) {
+        err = FUNCDEP_ERR_IO;
+    }
+    fclose(fp);
+    if (!err) {
+        text[len] = '\0';
+        err = funcdep_parse(text, out, err_line);
+    }
+    free(text);
+    return err;
+}
+
+void funcdep_free(funcdep_t *fd) {
+    if (fd != NULL) {
+        free(fd->nodes);
+        free(fd);
+    }
+}
+
+uint8_t funcdep_n_attribs(const funcdep_t *fd) {
+    return fd->n_attribs;
+}
+
+uint32_t funcdep_n_fds(const funcdep_t *fd) {
+    return fd->q.size;
+}
+
+// FD number i (in insertion order)
+int8_t funcdep_get(const funcdep_t *fd, uint32_t i, uint32_t *lhs,
+    uint32_t *rhs) {
+    if (fd == NULL || i >= fd->q.size || lhs == NULL || rhs == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    *lhs = fd->nodes[i].key.lhs.set;
+    *rhs = fd->nodes[i].key.rhs.set;
+    return FUNCDEP_OK;
+}
+
+// Closure of attributes under FDs
+int8_t funcdep_closure(const funcdep_t *fd, uint32_t attribs,
+    uint32_t *closure) {
+    if (fd == NULL || closure == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    if (attribs & ~all_attribs(fd)) {
+        return FUNCDEP_ERR_ATTRIB;
+    }
+    const Set s = set_from_mask(attribs);
+    *closure = compute_closure(&s, &fd->q, fd->n_attribs).set;
+    return FUNCDEP_OK;
+}
+
+// Check if attributes determine all attributes
+int8_t funcdep_is_superkey(const funcdep_t *fd, uint32_t attribs,
+    uint8_t *result) {
+    if (fd == NULL || result == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    if (attribs & ~all_attribs(fd)) {
+        return FUNCDEP_ERR_ATTRIB;
+    }
+    const Set s = set_from_mask(attribs);
+    *result = is_superkey(&s, &fd->q, fd->n_attribs);
+    return FUNCDEP_OK;
+}
+
+// Reduce super-key to a candidate key contained in it
+int8_t funcdep_minimize(const funcdep_t *fd, uint32_t superkey,
+    uint32_t *key) {
+    uint8_t is_key;
+    int8_t err = funcdep_is_superkey(fd, superkey, &is_key);
+    if (err || key == NULL) {
+        return err ? err : FUNCDEP_ERR_ARG;
+    }
+    if (!is_key) {
+        return FUNCDEP_ERR_ARG;
+    }
+    Set s = set_from_mask(superkey);
+    *key = candidate_key_from_super_key(&s, &fd->q, fd->n_attribs).set;
+    return FUNCDEP_OK;
+}
+
+// Workspace for key enumeration, reused across calls
+int8_t funcdep_ws_create(funcdep_ws_t **out) {
+    if (out == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    *out = (funcdep_ws_t *) calloc(1, sizeof(funcdep_ws_t));
+    return *out == NULL ? FUNCDEP_ERR_NOMEM : FUNCDEP_OK;
+}
+
+void funcdep_ws_free(funcdep_ws_t *ws) {
+    if (ws != NULL) {
+        free(ws->keys);
+        free(ws);
+    }
+}
+
+static int8_t ws_push(funcdep_ws_t *ws, uint32_t key) {
+    if (ws->n_keys == ws->cap) {
+        const uint32_t cap = ws->cap ? 2 * ws->cap : 256;
+        uint32_t *keys = (uint32_t *) realloc(ws->keys, cap * sizeof(uint32_t));
+        if (keys == NULL) {
+            return FUNCDEP_ERR_NOMEM;
+        }
+        ws->keys = keys;
+        ws->cap = cap;
+    }
+    ws->keys[ws->n_keys++] = key;
+    return FUNCDEP_OK;
+}
+
+// Lucchesi-Osborn enumeration that stops after every key: processes
+// FDs of work key keys[next-1] from fd_iter on
+typedef struct {
+    const funcdep_t *fd;
+    funcdep_ws_t *ws;
+    uint32_t next;          // next work key
+    uint32_t key;           // current work key
+    Q_iterator_t fd_iter;   // next FD for current work key (NULL: none)
+    uint8_t started;
+} lo_state_t;
+
+static void lo_start(lo_state_t *st, const funcdep_t *fd, funcdep_ws_t *ws) {
+    *st = (lo_state_t) {.fd = fd, .ws = ws, .next = 0, .key = 0,
+                        .fd_iter = NULL, .started = 0};
+    ws->n_keys = 0;
+}
+
+// Find next candidate key; FUNCDEP_DONE once all are found
+static int8_t lo_next(lo_state_t *st, uint32_t *key) {
+    const funcdep_t *fd = st->fd;
+    funcdep_ws_t *ws = st->ws;
+    if (!st->started) {
+        // First key is a minimized set of all attributes
+        st->started = 1;
+        Set attribs;
+        Set_full(&attribs, fd->n_attribs);
+        *key = candidate_key_from_super_key(&attribs, &fd->q,
+            fd->n_attribs).set;
+        return ws_push(ws, *key);
+    }
+    for (;;) {
+        if (st->fd_iter == NULL) {
+            if (st->next == ws->n_keys) {
+                return FUNCDEP_DONE;
+            }
+            st->key = ws->keys[st->next++];
+            st->fd_iter = Q_iterator(&fd->q);
+            continue;
+        }
+        const struct q_node_t *node = st->fd_iter;
+        st->fd_iter = node->next;
+        // S = lhs + (key - rhs) is a super-key; it yields a new
+        // candidate key unless it contains a known one
+        const uint32_t s = node->key.lhs.set | (st->key & ~node->key.rhs.set);
+        uint32_t i;
+        for (i = 0; i < ws->n_keys; ++i) {
+            if ((ws->keys[i] & ~s) == 0) {
+                break;
+            }
+        }
+        if (i < ws->n_keys) {
+            continue;
+        }
+        Set S = set_from_mask(s);
+        *key = candidate_key_from_super_key(&S, &fd->q, fd->n_attribs).set;
+        return ws_push(ws, *key);
+    }
+}
+
+// Enumerate all candidate keys (Lucchesi-Osborn) and pass each to cb
+int8_t funcdep_keys(const funcdep_t *fd, funcdep_ws_t *ws,
+    funcdep_key_cb cb, void *arg, uint64_t *n_keys) {
+    if (fd == NULL || ws == NULL || cb == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    lo_state_t st;
+    lo_start(&st, fd, ws);
+    uint32_t key;
+    int8_t err;
+    while ((err = lo_next(&st, &key)) == FUNCDEP_OK) {
+        if (cb(key, arg)) {
+            err = FUNCDEP_STOPPED;
+            break;
+        }
+    }
+    if (n_keys != NULL) {
+        *n_keys = ws->n_keys;
+    }
+    return err == FUNCDEP_DONE ? FUNCDEP_OK : err;
+}
+
+// Iterator: enumeration state with a workspace of its own
+struct funcdep_iter {
+    funcdep_ws_t ws;
+    lo_state_t st;
+};
+
+// Start lazy enumeration of candidate keys of fd
+int8_t funcdep_iter_create(const funcdep_t *fd, funcdep_iter_t **out) {
+    if (fd == NULL || out == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    funcdep_iter_t *it = (funcdep_iter_t *) calloc(1, sizeof(funcdep_iter_t));
+    if (it == NULL) {
+        return FUNCDEP_ERR_NOMEM;
+    }
+    lo_start(&it->st, fd, &it->ws);
+    *out = it;
+    return FUNCDEP_OK;
+}
+
+// Restart enumeration, keeping allocations of iterator
+int8_t funcdep_iter_reset(funcdep_iter_t *it, const funcdep_t *fd) {
+    if (it == NULL || fd == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    lo_start(&it->st, fd, &it->ws);
+    return FUNCDEP_OK;
+}
+
+// Advance enumeration by one key
+int8_t funcdep_iter_next(funcdep_iter_t *it, uint32_t *key) {
+    if (it == NULL || key == NULL) {
+        return FUNCDEP_ERR_ARG;
+    }
+    return lo_next(&it->st, key);
+}
+
+uint64_t funcdep_iter_count(const funcdep_iter_t *it) {
+    return it->ws.n_keys;
+}
+
+void funcdep_iter_free(funcdep_iter_t *it) {
+    if (it != NULL) {
+        free(it->ws.keys);
+        free(it);
+    }
+}
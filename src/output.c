@@ -0,0 +1,299 @@
+#include "output.h"
+#include "set.h"
+#include "store.h"
+#include "stats.h"
+#include "trace.h"
+#include "control.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// Size of a batch; a key takes at most MAX_KEY_LEN bytes in any format
+#define BATCH_SIZE (1u << 20)
+#define MAX_KEY_LEN (16u + 4u * MAX_ATTRIBS)
+// A batch is handed on early once the last one left this long ago, so
+// keys found slowly are seen promptly
+#define FLUSH_NS 50000000ull
+// Clock is read for every key of a batch up to this many keys, then
+// for every FLUSH_CHECK-th key
+#define FLUSH_CHECK 64u
+
+typedef struct {
+    char *data;
+    size_t len;
+    uint64_t n_keys;
+} batch_t;
+
+static FILE *sink = NULL;
+static uint8_t format = OUTPUT_TEXT;
+static batch_t fill = {NULL, 0, 0};  // batch being formatted
+static uint64_t last_submit_ns = 0;
+static uint8_t submitted = 0;     // some batch was handed on
+
+// Writer thread state: batch handed over for writing
+static uint8_t threaded = 0;
+static pthread_t writer;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static batch_t pending = {NULL, 0, 0};
+static uint8_t has_pending = 0;
+static uint8_t closing = 0;
+
+// Write batch through to the file; its keys count as emitted once the
+// write returns
+static void write_batch(const batch_t *b) {
+    if (b->len == 0) {
+        return;
+    }
+    if (fwrite(b->data, 1, b->len, sink) != b->len || fflush(sink) != 0) {
+        fprintf(stderr, "Could not write keys!\n");
+        exit(EXIT_FAILURE);
+    }
+    if (stats_enabled) {
+        stats_keys_emitted(b->n_keys, control_elapsed_ns());
+    }
+}
+
+static void *writer_main(void *arg) {
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    while (1) {
+        while (!has_pending && !closing) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        if (!has_pending) {
+            break;
+        }
+        // Write without holding lock so formatting can continue
+        pthread_mutex_unlock(&lock);
+        const uint64_t span = trace_start();
+        write_batch(&pending);
+        trace_end("write batch", span);
+        pthread_mutex_lock(&lock);
+        has_pending = 0;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+// Wait until writer thread has no batch in hand
+static void wait_writer(void) {
+    pthread_mutex_lock(&lock);
+    while (has_pending) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// Hand batch to writer thread or write it directly
+static void submit(void) {
+    submitted = 1;
+    last_submit_ns = control_elapsed_ns();
+    stats_phase_begin(STATS_OUTPUT);
+    if (!threaded) {
+        write_batch(&fill);
+        fill.len = 0;
+        fill.n_keys = 0;
+        stats_phase_end(STATS_OUTPUT);
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    while (has_pending) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    // Swap buffers: writer gets filled batch, formatting continues in
+    // the one just written
+    char *free_data = pending.data;
+    pending = fill;
+    has_pending = 1;
+    fill.data = free_data;
+    fill.len = 0;
+    fill.n_keys = 0;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    stats_phase_end(STATS_OUTPUT);
+}
+
+// Look up format by name; returns OUTPUT_INVALID if unknown
+uint8_t output_format(const char *name) {
+    static const char *names[OUTPUT_INVALID] = {
+        "text", "ndjson", "csv", "hex", "binary"
+    };
+    uint8_t i;
+    for (i = 0; i < OUTPUT_INVALID; ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return OUTPUT_INVALID;
+}
+
+// Direct keys to file at path (NULL: stdout) in given format. Keys in
+// formats other than text written to stdout get stdout for themselves;
+// all other output is moved to stderr. Returns 0 on success.
+int8_t output_init(uint8_t fmt, const char *path, uint8_t use_thread) {
+    format = fmt;
+    if (path != NULL) {
+        sink = fopen(path, "wb");
+        if (sink == NULL) {
+            fprintf(stderr, "Could not open output file at '%s'!\n", path);
+            return 1;
+        }
+    } else if (format != OUTPUT_TEXT) {
+        fflush(stdout);
+        const int fd = dup(STDOUT_FILENO);
+        sink = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if (sink == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            fprintf(stderr, "Could not redirect standard output!\n");
+            return 1;
+        }
+    } else {
+        sink = stdout;
+    }
+    fill.data = (char *) malloc(BATCH_SIZE);
+    if (fill.data == NULL) {
+        fprintf(stderr, "Could not allocate output buffer!\n");
+        return 1;
+    }
+    fill.len = 0;
+    fill.n_keys = 0;
+    submitted = 0;
+    threaded = 0;
+    if (use_thread) {
+        pending.data = (char *) malloc(BATCH_SIZE);
+        has_pending = 0;
+        closing = 0;
+        if (pending.data == NULL ||
+            pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+            // Keys are then written by the calling thread
+            fprintf(stderr, "Could not start writer thread, writing keys "
+                "directly\n");
+            free(pending.data);
+            pending.data = NULL;
+        } else {
+            threaded = 1;
+        }
+    }
+    return 0;
+}
+
+// Append key to output (and result file if one is written)
+void output_key(const Set *key) {
+    store_add(key->set);
+    if (BATCH_SIZE - fill.len < MAX_KEY_LEN) {
+        submit();
+    }
+    // First key goes out at once, later ones at least every FLUSH_NS
+    uint8_t due = 0;
+    if (fill.n_keys < FLUSH_CHECK || fill.n_keys % FLUSH_CHECK == 0) {
+        due = !submitted || control_elapsed_ns() - last_submit_ns >= FLUSH_NS;
+    }
+    char *out = fill.data + fill.len;
+    uint32_t bits = key->set, first = 1;
+    switch (format) {
+        case OUTPUT_TEXT:
+            while (bits) {
+                *out++ = (char)('A' + __builtin_ctz(bits));
+                *out++ = ' ';
+                bits &= bits - 1;
+            }
+            *out++ = '\n';
+            break;
+        case OUTPUT_NDJSON:
+            memcpy(out, "{\"key\":[", 8);
+            out += 8;
+            while (bits) {
+                if (!first) {
+                    *out++ = ',';
+                }
+                *out++ = '"';
+                *out++ = (char)('A' + __builtin_ctz(bits));
+                *out++ = '"';
+                bits &= bits - 1;
+                first = 0;
+            }
+            memcpy(out, "]}\n", 3);
+            out += 3;
+            break;
+        case OUTPUT_CSV:
+            while (bits) {
+                if (!first) {
+                    *out++ = ',';
+                }
+                *out++ = (char)('A' + __builtin_ctz(bits));
+                bits &= bits - 1;
+                first = 0;
+            }
+            *out++ = '\n';
+            break;
+        case OUTPUT_HEX: {
+            static const char digits[] = "0123456789abcdef";
+            int8_t shift;
+            *out++ = '0';
+            *out++ = 'x';
+            for (shift = 28; shift >= 0; shift -= 4) {
+                *out++ = digits[(bits >> shift) & 0xf];
+            }
+            *out++ = '\n';
+            break;
+        }
+        default:
+            *out++ = (char)(bits & 0xff);
+            *out++ = (char)((bits >> 8) & 0xff);
+            *out++ = (char)((bits >> 16) & 0xff);
+            *out++ = (char)(bits >> 24);
+            break;
+    }
+    fill.len = (size_t)(out - fill.data);
+    ++fill.n_keys;
+    if (due) {
+        submit();
+    }
+}
+
+// Write all pending keys (wait for writer thread)
+void output_flush(void) {
+    if (sink == NULL) {
+        return;
+    }
+    if (threaded) {
+        submit();
+        stats_phase_begin(STATS_OUTPUT);
+        wait_writer();
+    } else {
+        stats_phase_begin(STATS_OUTPUT);
+        write_batch(&fill);
+        fill.len = 0;
+        fill.n_keys = 0;
+    }
+    fflush(sink);
+    stats_phase_end(STATS_OUTPUT);
+}
+
+// Flush and release output; stops writer thread
+void output_close(void) {
+    if (sink == NULL) {
+        return;
+    }
+    output_flush();
+    if (threaded) {
+        pthread_mutex_lock(&lock);
+        closing = 1;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        pthread_join(writer, NULL);
+        free(pending.data);
+        pending.data = NULL;
+    }
+    if (sink != stdout) {
+        fclose(sink);
+    }
+    sink = NULL;
+    free(fill.data);
+    fill.data = NULL;
+}
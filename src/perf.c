@@ -0,0 +1,241 @@
+// syscall() is not part of POSIX
+#define _GNU_SOURCE
+
+#include "perf.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+uint8_t perf_enabled = 0;
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} events[PERF_N_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache-misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch-misses"},
+};
+
+typedef struct {
+    uint64_t count[PERF_N_EVENTS];
+} perf_counts_t;
+
+// Phase counters are inherited by threads created later, so counts
+// read after joining them include their work
+static int phase_fd[PERF_N_EVENTS];
+static perf_counts_t phase_start[STATS_N_PHASES];
+static perf_counts_t phase_total[STATS_N_PHASES];
+static uint8_t available[PERF_N_EVENTS];
+
+// Region counters form one group per thread, opened on first use
+static _Thread_local int group_fd = -2;  // -2: not opened yet, -1: failed
+static _Thread_local int group_index[PERF_N_EVENTS];
+static _Thread_local uint8_t group_size = 0;
+static _Thread_local perf_counts_t region_start[PERF_N_REGIONS];
+static _Thread_local perf_counts_t region_local[PERF_N_REGIONS];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static perf_counts_t region_total[PERF_N_REGIONS];
+
+static int open_event(uint8_t e, int group, uint8_t inherit, uint64_t format) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[e].type;
+    attr.config = events[e].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = inherit;
+    attr.read_format = format;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Count scaled up if event was multiplexed with others
+static uint64_t scaled(uint64_t value, uint64_t enabled, uint64_t running) {
+    if (running == 0) {
+        return 0;
+    }
+    return running < enabled ?
+        (uint64_t)((double) value * (double) enabled / (double) running) : value;
+}
+
+static void read_phase(perf_counts_t *c) {
+    uint8_t e;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        uint64_t buf[3] = {0, 0, 0};
+        c->count[e] = 0;
+        if (available[e] && read(phase_fd[e], buf, sizeof(buf)) == sizeof(buf)) {
+            c->count[e] = scaled(buf[0], buf[1], buf[2]);
+        }
+    }
+}
+
+// Open counters for phases; returns 0 if hardware counters are usable
+int8_t perf_init(void) {
+    const uint64_t format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+    uint8_t e, n_available = 0;
+    int err = 0;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        phase_fd[e] = open_event(e, -1, 1, format);
+        available[e] = phase_fd[e] >= 0;
+        if (available[e]) {
+            ++n_available;
+        } else if (err == 0) {
+            err = errno;
+        }
+    }
+    if (!available[PERF_CYCLES] || n_available == 0) {
+        fprintf(stderr, "Hardware performance counters unavailable (%s), "
+            "continuing without them\n", strerror(err));
+        for (e = 0; e < PERF_N_EVENTS; ++e) {
+            if (available[e]) {
+                close(phase_fd[e]);
+                available[e] = 0;
+            }
+        }
+        return 1;
+    }
+    perf_enabled = 1;
+    return 0;
+}
+
+void perf_phase_begin(uint8_t phase) {
+    if (perf_enabled) {
+        read_phase(&phase_start[phase]);
+    }
+}
+
+void perf_phase_end(uint8_t phase) {
+    if (!perf_enabled) {
+        return;
+    }
+    perf_counts_t now;
+    read_phase(&now);
+    uint8_t e;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        phase_total[phase].count[e] += now.count[e] - phase_start[phase].count[e];
+    }
+}
+
+// Open group of region counters for calling thread
+static void open_group(void) {
+    const uint64_t format = PERF_FORMAT_GROUP |
+                            PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+    uint8_t e;
+    group_size = 0;
+    group_fd = -1;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        group_index[e] = -1;
+        if (!available[e]) {
+            continue;
+        }
+        const int fd = open_event(e, group_fd, 0, format);
+        if (fd < 0) {
+            continue;
+        }
+        if (group_fd < 0) {
+            group_fd = fd;
+        }
+        group_index[e] = group_size++;
+    }
+}
+
+static void read_group(perf_counts_t *c) {
+    // Layout: nr, time enabled, time running, values
+    uint64_t buf[3 + PERF_N_EVENTS];
+    uint8_t e;
+    const ssize_t len = (ssize_t)((3 + group_size) * sizeof(uint64_t));
+    const uint8_t ok = read(group_fd, buf, (size_t) len) == len;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        c->count[e] = ok && group_index[e] >= 0 ?
+            scaled(buf[3 + group_index[e]], buf[1], buf[2]) : 0;
+    }
+}
+
+void perf_region_enter(uint8_t region) {
+    if (group_fd == -2) {
+        open_group();
+    }
+    if (group_fd >= 0) {
+        read_group(&region_start[region]);
+    }
+}
+
+void perf_region_leave(uint8_t region) {
+    if (group_fd < 0) {
+        return;
+    }
+    perf_counts_t now;
+    read_group(&now);
+    uint8_t e;
+    for (e = 0; e < PERF_N_EVENTS; ++e) {
+        region_local[region].count[e] += now.count[e] -
+                                         region_start[region].count[e];
+    }
+}
+
+// Add region counts of calling thread to totals (call before it exits)
+void perf_merge_thread(void) {
+    if (group_fd < 0) {
+        return;
+    }
+    uint8_t r, e;
+    pthread_mutex_lock(&lock);
+    for (r = 0; r < PERF_N_REGIONS; ++r) {
+        for (e = 0; e < PERF_N_EVENTS; ++e) {
+            region_total[r].count[e] += region_local[r].count[e];
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    memset(region_local, 0, sizeof(region_local));
+    close(group_fd);
+    group_fd = -2;
+}
+
+static void print_row(const char *name, const perf_counts_t *c) {
+    const uint64_t *n = c->count;
+    fprintf(stderr, "  %-12s %14lu %14lu %6.2f", name,
+        (unsigned long) n[PERF_CYCLES], (unsigned long) n[PERF_INSTRUCTIONS],
+        n[PERF_CYCLES] ? (double) n[PERF_INSTRUCTIONS] / n[PERF_CYCLES] : 0.0);
+    uint8_t e;
+    for (e = PERF_CACHE_MISSES; e < PERF_N_EVENTS; ++e) {
+        if (available[e]) {
+            fprintf(stderr, " %14lu", (unsigned long) n[e]);
+        } else {
+            fprintf(stderr, " %14s", "n/a");
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+// Print counts, IPC and misses per phase and region on stderr
+void perf_report(void) {
+    static const char *region_names[PERF_N_REGIONS] = {
+        "closure", "key scan"
+    };
+    if (!perf_enabled) {
+        return;
+    }
+    perf_merge_thread();
+    uint8_t i;
+    fprintf(stderr, "Hardware counters (user space):\n");
+    fprintf(stderr, "  %-12s %14s %14s %6s %14s %14s\n", "phase/region",
+        "cycles", "instructions", "IPC", "cache misses", "branch misses");
+    for (i = 0; i < STATS_N_PHASES; ++i) {
+        print_row(stats_phase_name(i), &phase_total[i]);
+    }
+    for (i = 0; i < PERF_N_REGIONS; ++i) {
+        print_row(region_names[i], &region_total[i]);
+    }
+}
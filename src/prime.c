@@ -0,0 +1,205 @@
+#include "prime.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "stats.h"
+#include "trace.h"
+#include "cpu.h"
+#include "control.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define CACHE_BITS 16
+#define CACHE_VALID (1ull << 31)
+
+// Lossy direct-mapped cache of closures shared by all threads. Entries
+// pack set and closure into one 64 bit word, so concurrent readers
+// always see consistent pairs.
+typedef struct {
+    _Atomic uint64_t *entries;
+} closure_cache_t;
+
+typedef struct {
+    const Queue *q;
+    uint8_t n_attribs;
+    closure_cache_t cache;
+    atomic_uint next_attrib;       // next attribute to decide
+    _Atomic uint32_t prime;        // attributes known to be prime
+    _Atomic uint32_t not_prime;    // attributes known not to be prime
+    Set *witness;
+    pthread_mutex_t witness_lock;
+} prime_ctx_t;
+
+CPU_DISPATCH_POPCNT
+static Set cached_closure(const Set *s, void *arg) {
+    prime_ctx_t *ctx = (prime_ctx_t *) arg;
+    const uint32_t slot = (s->set * 0x9E3779B1u) >> (32 - CACHE_BITS);
+    const uint64_t e = atomic_load_explicit(&ctx->cache.entries[slot],
+                                            memory_order_relaxed);
+    Set closure;
+    Set_init(&closure);
+    if ((e & CACHE_VALID) && (uint32_t)(e >> 32) == s->set) {
+        closure.set = (uint32_t)(e & (CACHE_VALID - 1));
+        closure.size = __builtin_popcount(closure.set);
+        return closure;
+    }
+    closure = compute_closure(s, ctx->q, ctx->n_attribs);
+    atomic_store_explicit(&ctx->cache.entries[slot],
+        ((uint64_t) s->set << 32) | CACHE_VALID | closure.set,
+        memory_order_relaxed);
+    return closure;
+}
+
+// Record witness key; all its attributes are prime
+static void add_witness(prime_ctx_t *ctx, const Set *key) {
+    pthread_mutex_lock(&ctx->witness_lock);
+    Set iter;
+    Set_copy(&iter, key);
+    uint8_t i, attrib;
+    for (i = 0; i < key->size; ++i) {
+        attrib = Set_next_pos(&iter);
+        if (ctx->witness[attrib].size == 0) {
+            Set_copy(&ctx->witness[attrib], key);
+        }
+    }
+    atomic_fetch_or(&ctx->prime, key->set);
+    pthread_mutex_unlock(&ctx->witness_lock);
+}
+
+// Depth-first search for a candidate key containing in and avoiding
+// out; stops at first key found or once target is known to be prime
+static uint8_t find_key(prime_ctx_t *ctx, Set in, Set out, uint8_t target) {
+    const uint8_t n_attribs = ctx->n_attribs;
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    
+    for (;;) {
+        if (atomic_load_explicit(&ctx->prime, memory_order_relaxed) &
+            (1u << target)) {
+            return 1;  // decided by another search
+        }
+        const uint32_t next = atomic_load_explicit(&ctx->next_attrib,
+                                                   memory_order_relaxed);
+        if (control_poll(next < n_attribs ? n_attribs - next : 0)) {
+            return 0;  // undecided
+        }
+        const uint8_t status = propagate_key_decisions_with(&in, &out,
+            n_attribs, cached_closure, ctx);
+        if (status == NODE_PRUNED) {
+            return 0;
+        }
+        if (status == NODE_KEY) {
+            add_witness(ctx, &in);
+            return 1;
+        }
+        Set allowed = Set_difference(&attribs, &out);
+        Set free = Set_difference(&allowed, &in);
+        const uint8_t attrib = Set_next_pos(&free);
+        assert(attrib != INVALID_ATTRIB);
+        Set with = in;
+        Set_insert(&with, attrib);
+        if (find_key(ctx, with, out, target)) {
+            return 1;
+        }
+        Set_insert(&out, attrib);
+    }
+}
+
+static void *prime_worker(void *arg) {
+    prime_ctx_t *ctx = (prime_ctx_t *) arg;
+    uint32_t attrib;
+    while (!control_stopped() &&
+           (attrib = atomic_fetch_add(&ctx->next_attrib, 1)) < ctx->n_attribs) {
+        if (atomic_load(&ctx->prime) & (1u << attrib)) {
+            continue;  // witness found while deciding other attribute
+        }
+        Set in, out;
+        Set_init(&in);
+        Set_init(&out);
+        Set_insert(&in, (uint8_t) attrib);
+        const uint64_t span = trace_start();
+        if (!find_key(ctx, in, out, (uint8_t) attrib) && !control_stopped()) {
+            atomic_fetch_or(&ctx->not_prime, 1u << attrib);
+        }
+        trace_end("prime attribute", span);
+    }
+    stats_merge_thread();
+    return NULL;
+}
+
+// Determine prime attributes; stores witness key for each prime
+// attribute in witness (empty set for non-prime attributes) and the
+// attributes decided in decided (all unless the run was stopped)
+Set compute_prime_attribs(const Queue *q, uint8_t n_attribs, uint32_t n_threads,
+    Set witness[MAX_ATTRIBS], uint32_t *decided) {
+    
+    assert(n_threads > 0);
+    prime_ctx_t ctx = {.q = q, .n_attribs = n_attribs, .witness = witness};
+    ctx.cache.entries = (_Atomic uint64_t *) calloc(1u << CACHE_BITS,
+                                                    sizeof(uint64_t));
+    assert(ctx.cache.entries != NULL);
+    atomic_init(&ctx.next_attrib, 0);
+    atomic_init(&ctx.prime, 0);
+    atomic_init(&ctx.not_prime, 0);
+    pthread_mutex_init(&ctx.witness_lock, NULL);
+    uint8_t i;
+    for (i = 0; i < MAX_ATTRIBS; ++i) {
+        Set_init(&witness[i]);
+    }
+    // Any key decides all of its attributes at once
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    const Set first = candidate_key_from_super_key(&attribs, q, n_attribs);
+    add_witness(&ctx, &first);
+    
+    pthread_t *threads = (pthread_t *) malloc(n_threads * sizeof(pthread_t));
+    assert(threads != NULL);
+    uint32_t t;
+    for (t = 0; t < n_threads; ++t) {
+        if (pthread_create(&threads[t], NULL, prime_worker, &ctx) != 0) {
+            fprintf(stderr, "Failed to create worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (t = 0; t < n_threads; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    
+    Set prime;
+    Set_init(&prime);
+    prime.set = atomic_load(&ctx.prime);
+    prime.size = __builtin_popcount(prime.set);
+    *decided = prime.set | atomic_load(&ctx.not_prime);
+    
+    free(threads);
+    free(ctx.cache.entries);
+    pthread_mutex_destroy(&ctx.witness_lock);
+    return prime;
+}
+
+// Print prime attributes together with witness keys
+void print_prime_attribs(const Queue *q, uint8_t n_attribs, uint32_t n_threads) {
+    Set witness[MAX_ATTRIBS];
+    uint32_t decided;
+    Set prime = compute_prime_attribs(q, n_attribs, n_threads, witness,
+                                      &decided);
+    uint8_t i;
+    for (i = 0; i < n_attribs; ++i) {
+        if (prime.set & (1u << i)) {
+            printf("%c: prime, key: ", (char)(i + 'A'));
+            Set_print(&witness[i]);
+        } else if (!(decided & (1u << i))) {
+            printf("%c: undecided\n", (char)(i + 'A'));
+        } else {
+            printf("%c: not prime\n", (char)(i + 'A'));
+        }
+    }
+    printf("Prime attributes: ");
+    Set_print(&prime);
+    printf("Number of prime attributes: %u\n", prime.size);
+}
@@ -1,5 +1,6 @@
 #include "queue.h"
 #include "set.h"
+#include "stats.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,7 @@ void Q_insert(Queue *q, q_key_t key) {
     struct q_node_t *new_node = (struct q_node_t *) 
                                 malloc(sizeof(struct q_node_t));
     assert(new_node != NULL);
+    stats_alloc(MEM_QUEUE, sizeof(struct q_node_t));
     
     new_node->key = key;
     new_node->next = NULL;
@@ -45,6 +47,7 @@ q_key_t Q_pop(Queue *q) {
     struct q_node_t *temp = q->tail;
     q->tail = q->tail->next;
     free(temp);
+    stats_free(MEM_QUEUE, sizeof(struct q_node_t));
     if (q->tail == NULL) {
         // Head points to invalid memory address at this point
         // Set NULL
@@ -63,6 +66,7 @@ void Q_free(Queue *q) {
         q->tail = q->tail->next;
         free(temp);
     }
+    stats_free(MEM_QUEUE, q->size * sizeof(struct q_node_t));
     // Reset all members
     q->head = NULL;
     q->tail = NULL;
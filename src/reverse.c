@@ -0,0 +1,249 @@
+#include "reverse.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "output.h"
+#include "stats.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Every node fixes attributes that are part of the key (in) and
+// attributes that are excluded from it (out). Branching on a free
+// attribute a yields the children (in + a, out) and (in, out + a), so
+// a node is reached only through its parent and every candidate key
+// is a leaf with a unique path from the root.
+typedef struct {
+    Set in;
+    Set out;
+} rs_node_t;
+
+// Subtrees donated by busy workers to idle ones
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    rs_node_t *nodes;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t n_threads;
+    uint32_t n_idle;
+    atomic_uint hungry;  // number of workers waiting for work
+    uint8_t done;
+} rs_pool_t;
+
+// Keys are written as soon as they are found; the output layer takes
+// keys from one thread at a time
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t n_keys;
+} rs_output_t;
+
+typedef struct {
+    const Queue *q;
+    uint8_t n_attribs;
+    const key_constraints_t *c;
+    rs_pool_t *pool;
+    rs_output_t *output;
+} rs_worker_t;
+
+// Depth-first stack of worker; holds at most one pending sibling per
+// tree level. Nodes are donated from the bottom (largest subtrees).
+typedef struct {
+    rs_node_t nodes[MAX_ATTRIBS + 1];
+    uint32_t base;
+    uint32_t top;
+} rs_stack_t;
+
+static void stack_push(rs_stack_t *st, rs_node_t node) {
+    if (st->top == MAX_ATTRIBS + 1) {
+        // Reclaim slots freed by donations
+        uint32_t i;
+        for (i = st->base; i < st->top; ++i) {
+            st->nodes[i - st->base] = st->nodes[i];
+        }
+        st->top -= st->base;
+        st->base = 0;
+    }
+    assert(st->top < MAX_ATTRIBS + 1);
+    st->nodes[st->top++] = node;
+}
+
+static void pool_put(rs_pool_t *pool, rs_node_t node) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->size == pool->capacity) {
+        stats_resize(MEM_SEARCH, pool->capacity * sizeof(rs_node_t),
+            (pool->capacity ? 2 * pool->capacity : 16) * sizeof(rs_node_t));
+        pool->capacity = pool->capacity ? 2 * pool->capacity : 16;
+        pool->nodes = (rs_node_t *) realloc(pool->nodes,
+                                  pool->capacity * sizeof(rs_node_t));
+        assert(pool->nodes != NULL);
+    }
+    pool->nodes[pool->size++] = node;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Block until a donated subtree is available; returns 0 once all
+// workers are idle and no work is left
+static uint8_t pool_get(rs_pool_t *pool, rs_node_t *node) {
+    pthread_mutex_lock(&pool->lock);
+    ++pool->n_idle;
+    atomic_fetch_add(&pool->hungry, 1);
+    while (pool->size == 0 && !pool->done) {
+        if (pool->n_idle == pool->n_threads) {
+            // Nobody is left to donate work
+            pool->done = 1;
+            pthread_cond_broadcast(&pool->cond);
+            break;
+        }
+        pthread_cond_wait(&pool->cond, &pool->lock);
+    }
+    uint8_t found = 0;
+    if (pool->size > 0) {
+        *node = pool->nodes[--pool->size];
+        --pool->n_idle;
+        atomic_fetch_sub(&pool->hungry, 1);
+        found = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return found;
+}
+
+// Expand subtree rooted at node depth-first. Children not explored
+// immediately are pushed on the stack of the worker.
+static void expand(rs_worker_t *w, rs_stack_t *st, rs_node_t node) {
+    const Queue *q = w->q;
+    const uint8_t n_attribs = w->n_attribs;
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    
+    for (;;) {
+        if (control_poll(st->top - st->base)) {
+            return;
+        }
+        const uint8_t status = propagate_key_decisions(&node.in, &node.out,
+                                                       q, n_attribs);
+        if (!key_constraints_admit(w->c, &node.in, status)) {
+            return;
+        }
+        if (status == NODE_KEY) {
+            // Keys beyond the key limit are dropped, so no worker
+            // writes more than the limit allows in total
+            if (!control_key_found()) {
+                pthread_mutex_lock(&w->output->lock);
+                output_key(&node.in);
+                ++w->output->n_keys;
+                pthread_mutex_unlock(&w->output->lock);
+            }
+            return;
+        }
+        if (w->c->max_size < MAX_ATTRIBS) {
+            uint8_t unused;
+            if (key_weight_lower_bound(&node.in, &node.out, q, n_attribs, NULL,
+                                       &unused) > w->c->max_size) {
+                return;  // every key of subtree is too large
+            }
+        }
+        Set allowed = Set_difference(&attribs, &node.out);
+        Set free = Set_difference(&allowed, &node.in);
+        // Branch on lowest free attribute: explore inclusion first and
+        // defer exclusion
+        const uint8_t attrib = Set_next_pos(&free);
+        assert(attrib != INVALID_ATTRIB);
+        rs_node_t sibling = node;
+        Set_insert(&sibling.out, attrib);
+        stack_push(st, sibling);
+        Set_insert(&node.in, attrib);
+        // Hand out shallowest pending subtree to idle workers
+        if (atomic_load_explicit(&w->pool->hungry, memory_order_relaxed) > 0 &&
+            st->top - st->base > 1) {
+            pool_put(w->pool, st->nodes[st->base++]);
+        }
+    }
+}
+
+static void *worker_run(void *arg) {
+    rs_worker_t *w = (rs_worker_t *) arg;
+    rs_stack_t st = {.base = 0, .top = 0};
+    rs_node_t node;
+    
+    while (pool_get(w->pool, &node)) {
+        const uint64_t span = trace_start();
+        expand(w, &st, node);
+        while (st.top > st.base && !control_stopped()) {
+            expand(w, &st, st.nodes[--st.top]);
+        }
+        st.base = st.top = 0;
+        trace_end("subtree", span);
+    }
+    stats_merge_thread();
+    return NULL;
+}
+
+void print_all_candidate_keys_reverse(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c, uint32_t n_threads) {
+    
+    assert(n_threads > 0);
+    rs_pool_t pool = {.nodes = NULL, .size = 0, .capacity = 0,
+                      .n_threads = n_threads, .n_idle = 0, .done = 0};
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+    atomic_init(&pool.hungry, 0);
+    
+    // Root: constrained attributes are decided, as well as attributes
+    // that never appear on a right-hand side (part of every key) and
+    // attributes that only appear on right-hand sides (part of no key)
+    Set lhs_attribs, rhs_attribs, attribs;
+    Set_init(&lhs_attribs);
+    Set_init(&rhs_attribs);
+    Set_full(&attribs, n_attribs);
+    Q_iterator_t iter = Q_iterator(q);
+    while (iter) {
+        lhs_attribs = Set_union(&lhs_attribs, &iter->key.lhs);
+        rhs_attribs = Set_union(&rhs_attribs, &iter->key.rhs);
+        iter = iter->next;
+    }
+    rs_node_t root;
+    root.in = Set_difference(&attribs, &rhs_attribs);
+    root.out = Set_difference(&rhs_attribs, &lhs_attribs);
+    root.in = Set_union(&root.in, &c->include);
+    root.out = Set_union(&root.out, &c->exclude);
+    pool_put(&pool, root);
+    
+    rs_output_t output = {.n_keys = 0};
+    pthread_mutex_init(&output.lock, NULL);
+    rs_worker_t *workers = (rs_worker_t *) malloc(n_threads * sizeof(rs_worker_t));
+    pthread_t *threads = (pthread_t *) malloc(n_threads * sizeof(pthread_t));
+    assert(workers != NULL && threads != NULL);
+    
+    uint32_t t;
+    for (t = 0; t < n_threads; ++t) {
+        workers[t] = (rs_worker_t) {.q = q, .n_attribs = n_attribs, .c = c,
+                                    .pool = &pool, .output = &output};
+        if (pthread_create(&threads[t], NULL, worker_run, &workers[t]) != 0) {
+            fprintf(stderr, "Failed to create worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    for (t = 0; t < n_threads; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    output_flush();
+    printf("Number of candidate keys: %u\n", output.n_keys);
+    
+    // Cleanup
+    free(workers);
+    free(threads);
+    stats_free(MEM_SEARCH, pool.capacity * sizeof(rs_node_t));
+    free(pool.nodes);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&output.lock);
+}
@@ -0,0 +1,660 @@
+#include "serve.h"
+#include "funcdep.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NAME_LEN 64
+// Closure cache slots per FD set (direct mapped)
+#define CACHE_BITS 12
+#define CACHE_VALID (1ull << 63)
+
+// Resident FD set with the results computed for it so far
+typedef struct {
+    char name[NAME_LEN];
+    funcdep_t *fd;
+    uint32_t all;                  // mask of all attributes
+    atomic_uint refs;              // registry and requests in flight
+    // Entry: CACHE_VALID | attribs << 32 | closure; a lost race only
+    // costs a recomputation
+    atomic_uint_fast64_t cache[1u << CACHE_BITS];
+    pthread_mutex_t lock;          // guards analysis below
+    uint8_t analyzed;
+    uint32_t *keys;
+    uint64_t n_keys;
+    uint32_t primes;               // union of keys
+    const char *nf;                // highest normal form
+    uint32_t bad_lhs, bad_rhs;     // FD violating next normal form
+} entry_t;
+
+// Growable key list filled by enumeration callback
+typedef struct {
+    uint32_t *keys;
+    uint64_t n_keys;
+    uint64_t cap;
+} key_list_t;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static entry_t **entries = NULL;
+static uint32_t n_entries = 0, cap_entries = 0;
+
+static volatile sig_atomic_t stopping = 0;
+static atomic_uint n_clients = 0;
+static unsigned max_clients = 64;
+
+static atomic_uint_fast64_t n_connections = 0;
+static atomic_uint_fast64_t n_requests = 0;
+static atomic_uint_fast64_t request_ns = 0;
+static atomic_uint_fast64_t cache_hits = 0;
+static atomic_uint_fast64_t cache_misses = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+static void on_signal(int sig) {
+    (void) sig;
+    stopping = 1;
+}
+
+static entry_t *entry_create(const char *name, funcdep_t *fd) {
+    entry_t *e = (entry_t *) calloc(1, sizeof(entry_t));
+    if (e == NULL) {
+        return NULL;
+    }
+    strcpy(e->name, name);
+    e->fd = fd;
+    e->all = (uint32_t)((1ull << funcdep_n_attribs(fd)) - 1);
+    atomic_init(&e->refs, 1);
+    uint32_t i;
+    for (i = 0; i < (1u << CACHE_BITS); ++i) {
+        atomic_init(&e->cache[i], 0);
+    }
+    pthread_mutex_init(&e->lock, NULL);
+    return e;
+}
+
+// Drop reference; last one frees the entry
+static void entry_release(entry_t *e) {
+    if (atomic_fetch_sub(&e->refs, 1) == 1) {
+        pthread_mutex_destroy(&e->lock);
+        funcdep_free(e->fd);
+        free(e->keys);
+        free(e);
+    }
+}
+
+static int32_t registry_find(const char *name) {
+    uint32_t i;
+    for (i = 0; i < n_entries; ++i) {
+        if (strcmp(entries[i]->name, name) == 0) {
+            return (int32_t) i;
+        }
+    }
+    return -1;
+}
+
+// Entry of FD set name with a reference for the caller, or NULL
+static entry_t *registry_acquire(const char *name) {
+    pthread_mutex_lock(&registry_lock);
+    const int32_t i = registry_find(name);
+    entry_t *e = i < 0 ? NULL : entries[i];
+    if (e != NULL) {
+        atomic_fetch_add(&e->refs, 1);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return e;
+}
+
+// Store FD set under name, replacing an existing one; takes ownership
+// of fd
+static int8_t registry_put(const char *name, funcdep_t *fd) {
+    entry_t *e = entry_create(name, fd);
+    if (e == NULL) {
+        funcdep_free(fd);
+        return FUNCDEP_ERR_NOMEM;
+    }
+    entry_t *old = NULL;
+    pthread_mutex_lock(&registry_lock);
+    const int32_t i = registry_find(name);
+    if (i >= 0) {
+        old = entries[i];
+        entries[i] = e;
+    } else if (n_entries == cap_entries) {
+        const uint32_t cap = cap_entries ? 2 * cap_entries : 16;
+        entry_t **grown = (entry_t **) realloc(entries, cap * sizeof(entry_t *));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&registry_lock);
+            entry_release(e);
+            return FUNCDEP_ERR_NOMEM;
+        }
+        entries = grown;
+        cap_entries = cap;
+        entries[n_entries++] = e;
+    } else {
+        entries[n_entries++] = e;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (old != NULL) {
+        entry_release(old);
+    }
+    return FUNCDEP_OK;
+}
+
+// Remove FD set name; returns 1 if there was none
+static uint8_t registry_drop(const char *name) {
+    pthread_mutex_lock(&registry_lock);
+    const int32_t i = registry_find(name);
+    entry_t *e = i < 0 ? NULL : entries[i];
+    if (e != NULL) {
+        entries[i] = entries[--n_entries];
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (e == NULL) {
+        return 1;
+    }
+    entry_release(e);
+    return 0;
+}
+
+// Closure of attributes (within the FD set's attributes)
+static uint32_t cached_closure(entry_t *e, uint32_t attribs) {
+    const uint32_t slot = (attribs * 0x9e3779b1u) >> (32 - CACHE_BITS);
+    const uint64_t tag = CACHE_VALID | (uint64_t) attribs << 32;
+    const uint64_t v = atomic_load_explicit(&e->cache[slot], memory_order_relaxed);
+    if ((v & ~0xffffffffull) == tag) {
+        atomic_fetch_add_explicit(&cache_hits, 1, memory_order_relaxed);
+        return (uint32_t) v;
+    }
+    uint32_t closure;
+    funcdep_closure(e->fd, attribs, &closure);
+    atomic_store_explicit(&e->cache[slot], tag | closure, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cache_misses, 1, memory_order_relaxed);
+    return closure;
+}
+
+static int add_key(uint32_t key, void *arg) {
+    key_list_t *list = (key_list_t *) arg;
+    if (list->n_keys == list->cap) {
+        const uint64_t cap = list->cap ? 2 * list->cap : 64;
+        uint32_t *keys = (uint32_t *) realloc(list->keys, cap * sizeof(uint32_t));
+        if (keys == NULL) {
+            return 1;
+        }
+        list->keys = keys;
+        list->cap = cap;
+    }
+    list->keys[list->n_keys++] = key;
+    return 0;
+}
+
+// Highest normal form given keys and primes, with a witness FD
+// violating the next higher one. 2NF is checked on the largest proper
+// subsets of keys, 3NF and BCNF on the FDs themselves.
+static void normal_form(entry_t *e) {
+    uint64_t k;
+    for (k = 0; k < e->n_keys; ++k) {
+        uint32_t rest = e->keys[k];
+        while (rest) {
+            const uint32_t sub = e->keys[k] & ~(rest & -rest);
+            const uint32_t partial = cached_closure(e, sub) & ~sub & ~e->primes;
+            if (partial) {
+                e->nf = "1NF";
+                e->bad_lhs = sub;
+                e->bad_rhs = partial;
+                return;
+            }
+            rest &= rest - 1;
+        }
+    }
+    e->nf = "BCNF";
+    uint32_t i, lhs, rhs;
+    for (i = 0; i < funcdep_n_fds(e->fd); ++i) {
+        funcdep_get(e->fd, i, &lhs, &rhs);
+        rhs &= ~lhs;
+        if (rhs == 0 || cached_closure(e, lhs) == e->all) {
+            continue;
+        }
+        if (rhs & ~e->primes) {
+            e->nf = "2NF";
+            e->bad_lhs = lhs;
+            e->bad_rhs = rhs & ~e->primes;
+            return;
+        }
+        if (e->bad_rhs == 0) {
+            e->nf = "3NF";
+            e->bad_lhs = lhs;
+            e->bad_rhs = rhs;
+        }
+    }
+}
+
+// Compute keys, primes and normal form once per FD set
+static int8_t analyze(entry_t *e, funcdep_ws_t *ws) {
+    pthread_mutex_lock(&e->lock);
+    int8_t err = FUNCDEP_OK;
+    if (!e->analyzed) {
+        key_list_t list = {.keys = NULL, .n_keys = 0, .cap = 0};
+        err = funcdep_keys(e->fd, ws, add_key, &list, NULL);
+        if (err == FUNCDEP_STOPPED) {
+            err = FUNCDEP_ERR_NOMEM;
+        }
+        if (err) {
+            free(list.keys);
+        } else {
+            e->keys = list.keys;
+            e->n_keys = list.n_keys;
+            uint64_t k;
+            for (k = 0; k < list.n_keys; ++k) {
+                e->primes |= list.keys[k];
+            }
+            normal_form(e);
+            e->analyzed = 1;
+        }
+    }
+    pthread_mutex_unlock(&e->lock);
+    return err;
+}
+
+// Attribute letters of set, '-' for the empty set
+static void write_set(FILE *out, uint32_t set) {
+    if (set == 0) {
+        fputc('-', out);
+    }
+    for (; set; set &= set - 1) {
+        fputc('A' + __builtin_ctz(set), out);
+    }
+}
+
+// Parse attributes such as "AB", "A,B" or "-" (empty set)
+static uint8_t parse_attribs(const char *text, uint8_t n_attribs,
+    uint32_t *mask) {
+    *mask = 0;
+    if (strcmp(text, "-") == 0) {
+        return 0;
+    }
+    for (; *text; ++text) {
+        if ('A' <= *text && *text - 'A' < n_attribs) {
+            *mask |= 1u << (*text - 'A');
+        } else if (*text != ',') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Parse decimal count spanning all of text; returns 1 if malformed
+static uint8_t parse_count(const char *text, uint64_t *count) {
+    char *end;
+    if (*text < '0' || *text > '9') {
+        return 1;  // strtoull would accept sign and blanks
+    }
+    errno = 0;
+    *count = strtoull(text, &end, 10);
+    return *end != '\0' || errno != 0;
+}
+
+// Split off next space separated token of *p
+static char *next_token(char **p) {
+    char *s = *p + strspn(*p, " \t");
+    if (*s == '\0') {
+        *p = s;
+        return NULL;
+    }
+    char *end = s + strcspn(s, " \t");
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+    *p = end;
+    return s;
+}
+
+static uint8_t valid_name(const char *name) {
+    return name != NULL && strlen(name) < NAME_LEN;
+}
+
+static void reply_error(FILE *out, int8_t err, uint32_t err_line) {
+    fprintf(out, "ERR %s", funcdep_strerror(err));
+    if (err == FUNCDEP_ERR_PARSE || err == FUNCDEP_ERR_ATTRIB) {
+        fprintf(out, " (line %u)", err_line);
+    }
+    fputc('\n', out);
+}
+
+// Answer request line; returns 1 if client asked to quit
+static uint8_t handle_request(char *line, FILE *out, funcdep_ws_t **ws) {
+    char *rest = line;
+    const char *cmd = next_token(&rest);
+    if (cmd == NULL) {
+        fprintf(out, "ERR empty request\n");
+        return 0;
+    }
+    if (strcmp(cmd, "QUIT") == 0) {
+        fprintf(out, "OK\n");
+        return 1;
+    }
+    if (strcmp(cmd, "STATS") == 0) {
+        const uint64_t requests = atomic_load(&n_requests);
+        pthread_mutex_lock(&registry_lock);
+        const uint32_t sets = n_entries;
+        pthread_mutex_unlock(&registry_lock);
+        fprintf(out, "OK sets=%u connections=%lu requests=%lu "
+            "mean_request_us=%.2f closure_hits=%lu closure_misses=%lu\n",
+            sets, (unsigned long) atomic_load(&n_connections),
+            (unsigned long) requests,
+            requests ? 1e-3 * atomic_load(&request_ns) / requests : 0.0,
+            (unsigned long) atomic_load(&cache_hits),
+            (unsigned long) atomic_load(&cache_misses));
+        return 0;
+    }
+    if (strcmp(cmd, "LIST") == 0) {
+        fprintf(out, "OK");
+        pthread_mutex_lock(&registry_lock);
+        uint32_t i;
+        for (i = 0; i < n_entries; ++i) {
+            fprintf(out, " %s", entries[i]->name);
+        }
+        pthread_mutex_unlock(&registry_lock);
+        fputc('\n', out);
+        return 0;
+    }
+    const char *name = next_token(&rest);
+    if (!valid_name(name)) {
+        fprintf(out, "ERR missing or too long name\n");
+        return 0;
+    }
+    if (strcmp(cmd, "LOAD") == 0 || strcmp(cmd, "PUT") == 0) {
+        funcdep_t *fd;
+        uint32_t err_line = 0;
+        int8_t err;
+        if (cmd[0] == 'L') {
+            const char *path = next_token(&rest);
+            err = path == NULL ? FUNCDEP_ERR_ARG :
+                funcdep_load(path, &fd, &err_line);
+        } else {
+            // Inline text: FD lines separated by ';'
+            char *c;
+            for (c = rest; *c; ++c) {
+                if (*c == ';') {
+                    *c = '\n';
+                }
+            }
+            err = funcdep_parse(rest, &fd, &err_line);
+        }
+        if (!err) {
+            const uint8_t n_attribs = funcdep_n_attribs(fd);
+            const uint32_t n_fds = funcdep_n_fds(fd);
+            err = registry_put(name, fd);
+            if (!err) {
+                fprintf(out, "OK %u %u\n", n_attribs, n_fds);
+            }
+        }
+        if (err) {
+            reply_error(out, err, err_line);
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "DROP") == 0) {
+        fprintf(out, registry_drop(name) ? "ERR unknown FD set\n" : "OK\n");
+        return 0;
+    }
+    const uint8_t is_query = strcmp(cmd, "CLOSURE") == 0 ||
+        strcmp(cmd, "SUPERKEY") == 0 || strcmp(cmd, "KEYS") == 0 ||
+        strcmp(cmd, "NF") == 0;
+    if (!is_query) {
+        fprintf(out, "ERR unknown request %s\n", cmd);
+        return 0;
+    }
+    entry_t *e = registry_acquire(name);
+    if (e == NULL) {
+        fprintf(out, "ERR unknown FD set\n");
+        return 0;
+    }
+    const char *arg = next_token(&rest);
+    uint32_t attribs;
+    uint64_t limit = UINT64_MAX;
+    if (strcmp(cmd, "CLOSURE") == 0 || strcmp(cmd, "SUPERKEY") == 0) {
+        if (arg == NULL ||
+            parse_attribs(arg, funcdep_n_attribs(e->fd), &attribs)) {
+            fprintf(out, "ERR invalid attributes\n");
+        } else if (cmd[0] == 'C') {
+            fprintf(out, "OK ");
+            write_set(out, cached_closure(e, attribs));
+            fputc('\n', out);
+        } else {
+            fprintf(out, "OK %d\n", cached_closure(e, attribs) == e->all);
+        }
+    } else if (cmd[0] == 'K' && arg != NULL && parse_count(arg, &limit)) {
+        fprintf(out, "ERR invalid limit\n");
+    } else {
+        int8_t err = *ws == NULL ? funcdep_ws_create(ws) : FUNCDEP_OK;
+        if (!err) {
+            err = analyze(e, *ws);
+        }
+        if (err) {
+            reply_error(out, err, 0);
+        } else if (cmd[0] == 'N') {
+            fprintf(out, "OK %s", e->nf);
+            if (e->bad_rhs) {
+                fputc(' ', out);
+                write_set(out, e->bad_lhs);
+                fprintf(out, "->");
+                write_set(out, e->bad_rhs);
+            }
+            fputc('\n', out);
+        } else {
+            fprintf(out, "OK %lu", (unsigned long) e->n_keys);
+            uint64_t k;
+            for (k = 0; k < e->n_keys && k < limit; ++k) {
+                fputc(' ', out);
+                write_set(out, e->keys[k]);
+            }
+            fputc('\n', out);
+        }
+    }
+    entry_release(e);
+    return 0;
+}
+
+// Serve requests of one connection until it closes or quits
+static void *serve_client(void *arg) {
+    const int sock = (int)(intptr_t) arg;
+    const int sock_out = dup(sock);
+    FILE *in = fdopen(sock, "r");
+    FILE *out = sock_out < 0 ? NULL : fdopen(sock_out, "w");
+    funcdep_ws_t *ws = NULL;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while (in != NULL && out != NULL && (len = getline(&line, &cap, in)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        const uint64_t start = now_ns();
+        const uint8_t quit = handle_request(line, out, &ws);
+        atomic_fetch_add_explicit(&request_ns, now_ns() - start,
+            memory_order_relaxed);
+        atomic_fetch_add_explicit(&n_requests, 1, memory_order_relaxed);
+        if (fflush(out) != 0 || quit) {
+            break;
+        }
+    }
+    free(line);
+    funcdep_ws_free(ws);
+    if (in != NULL) {
+        fclose(in);
+    } else {
+        close(sock);
+    }
+    if (out != NULL) {
+        fclose(out);
+    } else if (sock_out >= 0) {
+        close(sock_out);
+    }
+    atomic_fetch_sub(&n_clients, 1);
+    return NULL;
+}
+
+static void print_serve_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s serve [options] <socket path>\n"
+        "  -L, --load <name>=<f> load FD file f as name before serving\n"
+        "  -c, --max-clients <n> most concurrent connections (default 64)\n"
+        "Requests, one per line: LOAD <name> <file>, PUT <name> <n>;<FD>;...,\n"
+        "DROP <name>, CLOSURE <name> <attrs>, SUPERKEY <name> <attrs>,\n"
+        "KEYS <name> [<limit>], NF <name>, LIST, STATS, QUIT\n", prog);
+}
+
+// Load FD file given as name=file
+static uint8_t preload(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    char name[NAME_LEN];
+    if (eq == NULL || eq == spec || eq - spec >= NAME_LEN) {
+        fprintf(stderr, "Invalid FD set '%s', expected <name>=<file>\n", spec);
+        return 1;
+    }
+    memcpy(name, spec, (size_t)(eq - spec));
+    name[eq - spec] = '\0';
+    funcdep_t *fd;
+    uint32_t err_line = 0;
+    int8_t err = funcdep_load(eq + 1, &fd, &err_line);
+    if (!err) {
+        err = registry_put(name, fd);
+    }
+    if (err) {
+        fprintf(stderr, "Could not load '%s': %s (line %u)\n", eq + 1,
+            funcdep_strerror(err), err_line);
+        return 1;
+    }
+    return 0;
+}
+
+// Run daemon; returns exit status once stopped by SIGINT/SIGTERM
+int serve_main(int argc, char *argv[], const char *prog) {
+    static const struct option long_options[] = {
+        {"load",        required_argument, NULL, 'L'},
+        {"max-clients", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "L:c:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'L':
+                if (preload(optarg)) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c': {
+                uint64_t n;
+                if (parse_count(optarg, &n) || n == 0 || n > UINT32_MAX) {
+                    fprintf(stderr, "Invalid client count '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                max_clients = (unsigned) n;
+                break;
+            }
+            default:
+                print_serve_usage(prog);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_serve_usage(prog);
+        return EXIT_FAILURE;
+    }
+    const char *path = argv[optind];
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    strcpy(addr.sun_path, path);
+    // Replace stale socket of an earlier run, nothing else
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    // Socket only accessible by owner
+    const mode_t mask = umask(077);
+    const int bound = listener >= 0 &&
+        bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+        listen(listener, 64) == 0;
+    umask(mask);
+    if (!bound) {
+        fprintf(stderr, "Could not listen on %s: %s\n", path, strerror(errno));
+        if (listener >= 0) {
+            close(listener);
+        }
+        return EXIT_FAILURE;
+    }
+    // accept() returns on SIGINT/SIGTERM; writes to closed connections
+    // fail instead of raising SIGPIPE
+    struct sigaction sa;
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+    // Signals go to this thread only
+    sigset_t worker_mask, main_mask;
+    sigemptyset(&worker_mask);
+    sigaddset(&worker_mask, SIGINT);
+    sigaddset(&worker_mask, SIGTERM);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    fprintf(stderr, "Listening on %s\n", path);
+    while (!stopping) {
+        const int sock = accept(listener, NULL, NULL);
+        if (sock < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                fprintf(stderr, "accept: %s\n", strerror(errno));
+                break;
+            }
+            continue;
+        }
+        if (atomic_fetch_add(&n_clients, 1) >= max_clients) {
+            atomic_fetch_sub(&n_clients, 1);
+            static const char busy[] = "ERR too many clients\n";
+            if (write(sock, busy, sizeof(busy) - 1) < 0) {
+                // Client is gone already
+            }
+            close(sock);
+            continue;
+        }
+        atomic_fetch_add(&n_connections, 1);
+        pthread_t thread;
+        pthread_sigmask(SIG_BLOCK, &worker_mask, &main_mask);
+        const int err = pthread_create(&thread, &attr, serve_client,
+            (void *)(intptr_t) sock);
+        pthread_sigmask(SIG_SETMASK, &main_mask, NULL);
+        if (err) {
+            atomic_fetch_sub(&n_clients, 1);
+            close(sock);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    close(listener);
+    unlink(path);
+    fprintf(stderr, "Stopped after %lu requests\n",
+        (unsigned long) atomic_load(&n_requests));
+    return EXIT_SUCCESS;
+}
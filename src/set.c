@@ -1,4 +1,5 @@
 #include "set.h"
+#include "cpu.h"
 
 #include <assert.h>
 #include <stdint.h>
@@ -9,6 +10,7 @@
  * 
  */
 // Union
+CPU_DISPATCH_POPCNT
 Set Set_union(const Set *s, const Set *t) {
     const uint32_t u = s->set | t->set;
     return (Set) { .set    = u, 
@@ -18,6 +20,7 @@ Set Set_union(const Set *s, const Set *t) {
 }
 
 // Intersection
+CPU_DISPATCH_POPCNT
 Set Set_intersection(const Set *s, const Set *t) {
     const uint32_t i = s->set & t->set;
     return (Set) { .set    = i, 
@@ -27,6 +30,7 @@ Set Set_intersection(const Set *s, const Set *t) {
 }
 
 // Difference
+CPU_DISPATCH_POPCNT
 Set Set_difference(const Set *s, const Set *t) {
     const uint32_t d = s->set & (~t->set);
     return (Set) { .set    = d, 
@@ -109,26 +113,26 @@ void Set_clear(Set *s) {
 
 // Return next attribute contained in set and maintain current
 // search position/count of attributes already visited
+CPU_DISPATCH_BMI
 uint8_t Set_next_pos(Set *s) {
-    uint8_t i;
-    for (i = s->cursor; i < MAX_ATTRIBS; ++i) {
-        // Check if i-th position is set
-        if ((s->set & (1u << i))) {
-            // Advance cursor
-            s->cursor = i + 1;
-            // Check if last attribute was reached
-            if (++s->count == s->size) {
-                // Reset cursor position
-                s->cursor = 0;
-                // Reset count
-                s->count = 0;
-            }
-            // Return found element of set
-            return i;
-        }
+    // Attributes at or after cursor
+    const uint32_t rest = s->set & (UINT32_MAX << s->cursor);
+    if (rest == 0) {
+        // Set is empty
+        return INVALID_ATTRIB;
     }
-    // Set is empty
-    return INVALID_ATTRIB;
+    const uint8_t i = (uint8_t) __builtin_ctz(rest);
+    // Advance cursor
+    s->cursor = i + 1;
+    // Check if last attribute was reached
+    if (++s->count == s->size) {
+        // Reset cursor position
+        s->cursor = 0;
+        // Reset count
+        s->count = 0;
+    }
+    // Return found element of set
+    return i;
 }
 
 // Print all attributes belonging to set
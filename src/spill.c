@@ -0,0 +1,535 @@
+#include "spill.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "output.h"
+#include "stats.h"
+#include "perf.h"
+#include "trace.h"
+#include "cpu.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// Runs of a partition are merged into one when there are this many
+#define KS_MERGE_FANIN 8
+// Keys tested per step of containment scans (vector width multiple)
+#define SCAN_BLOCK 16u
+
+// Private spill directory of the running enumeration (NULL: none)
+static const char *active_dir = NULL;
+
+// Remove spill directory with all files left in it
+static void remove_spill_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        char path[4096];
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 &&
+                strcmp(entry->d_name, "..") != 0) {
+                snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+// I/O errors on spill files cannot be recovered from; segment files
+// and the directory are removed before exiting
+static void spill_fail(const char *what, const char *path) {
+    fprintf(stderr, "Could not %s spill file '%s'!\n", what, path);
+    if (active_dir != NULL) {
+        remove_spill_dir(active_dir);
+    }
+    exit(EXIT_FAILURE);
+}
+
+static void spill_path(char *path, size_t len, const char *dir,
+    const char *kind, uint64_t id) {
+    snprintf(path, len, "%s/%s-%lu", dir, kind, (unsigned long) id);
+}
+
+static void write_all(int fd, const uint32_t *buf, uint32_t count,
+    uint64_t offset, const char *path) {
+    const char *data = (const char *) buf;
+    size_t left = (size_t) count * sizeof(uint32_t);
+    while (left > 0) {
+        const ssize_t n = pwrite(fd, data, left, (off_t) offset);
+        if (n <= 0) {
+            spill_fail("write", path);
+        }
+        data += n;
+        left -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+}
+
+static void read_all(int fd, uint32_t *buf, uint32_t count,
+    uint64_t offset, const char *path) {
+    char *data = (char *) buf;
+    size_t left = (size_t) count * sizeof(uint32_t);
+    while (left > 0) {
+        const ssize_t n = pread(fd, data, left, (off_t) offset);
+        if (n <= 0) {
+            spill_fail("read", path);
+        }
+        data += n;
+        left -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+}
+
+void SQ_init(spill_queue_t *sq, const char *dir, uint32_t seg_cap) {
+    assert(seg_cap > 0);
+    sq->dir = dir;
+    sq->seg_cap = seg_cap;
+    sq->head = (uint32_t *) malloc(sq->seg_cap * sizeof(uint32_t));
+    sq->tail = (uint32_t *) malloc(sq->seg_cap * sizeof(uint32_t));
+    assert(sq->head != NULL && sq->tail != NULL);
+    stats_alloc(MEM_KEYS, 2 * sq->seg_cap * sizeof(uint32_t));
+    sq->head_len = 0;
+    sq->tail_len = 0;
+    sq->tail_pos = 0;
+    sq->seg_first = 0;
+    sq->seg_next = 0;
+    sq->size = 0;
+}
+
+void SQ_push(spill_queue_t *sq, uint32_t mask) {
+    if (sq->head_len == sq->seg_cap) {
+        if (sq->seg_first == sq->seg_next && sq->tail_pos == sq->tail_len) {
+            // Nothing between the ends: head becomes new tail
+            uint32_t *tmp = sq->tail;
+            sq->tail = sq->head;
+            sq->tail_len = sq->head_len;
+            sq->tail_pos = 0;
+            sq->head = tmp;
+        } else {
+            // Spill full head buffer as next segment
+            char path[4096];
+            spill_path(path, sizeof(path), sq->dir, "seg", sq->seg_next);
+            const int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+            if (fd < 0) {
+                spill_fail("create", path);
+            }
+            write_all(fd, sq->head, sq->head_len, 0, path);
+            close(fd);
+            ++sq->seg_next;
+        }
+        sq->head_len = 0;
+    }
+    sq->head[sq->head_len++] = mask;
+    ++sq->size;
+}
+
+uint32_t SQ_pop(spill_queue_t *sq) {
+    assert(sq->size > 0);
+    if (sq->tail_pos == sq->tail_len) {
+        if (sq->seg_first < sq->seg_next) {
+            // Load oldest segment; segments are always full
+            char path[4096];
+            spill_path(path, sizeof(path), sq->dir, "seg", sq->seg_first);
+            const int fd = open(path, O_RDONLY);
+            if (fd < 0) {
+                spill_fail("open", path);
+            }
+            read_all(fd, sq->tail, sq->seg_cap, 0, path);
+            close(fd);
+            unlink(path);
+            ++sq->seg_first;
+            sq->tail_len = sq->seg_cap;
+        } else {
+            // Take over head buffer
+            uint32_t *tmp = sq->tail;
+            sq->tail = sq->head;
+            sq->tail_len = sq->head_len;
+            sq->head = tmp;
+            sq->head_len = 0;
+        }
+        sq->tail_pos = 0;
+    }
+    --sq->size;
+    return sq->tail[sq->tail_pos++];
+}
+
+void SQ_free(spill_queue_t *sq) {
+    char path[4096];
+    while (sq->seg_first < sq->seg_next) {
+        spill_path(path, sizeof(path), sq->dir, "seg", sq->seg_first++);
+        unlink(path);
+    }
+    free(sq->head);
+    free(sq->tail);
+    stats_free(MEM_KEYS, 2 * sq->seg_cap * sizeof(uint32_t));
+    sq->size = 0;
+}
+
+void KS_init(key_store_t *ks, const char *dir, uint32_t ram_cap,
+    uint32_t io_cap) {
+    ks->dir = dir;
+    ks->next_run = 0;
+    memset(ks->part, 0, sizeof(ks->part));
+    ks->ram_len = 0;
+    assert(ram_cap > 0);
+    ks->ram_cap = ram_cap;
+    ks->io_cap = io_cap;
+    // Merges need a window per run and one for output
+    if (ks->io_cap < KS_MERGE_FANIN + 1) {
+        ks->io_cap = KS_MERGE_FANIN + 1;
+    }
+    ks->io_buf = (uint32_t *) malloc(ks->io_cap * sizeof(uint32_t));
+    assert(ks->io_buf != NULL);
+    stats_alloc(MEM_KEYS, ks->io_cap * sizeof(uint32_t));
+    ks->size = 0;
+    ks->runs_read = 0;
+}
+
+static int compare_masks(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *) a;
+    const uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Create unlinked file for a new run; it lives until closed
+static int ks_open_run(key_store_t *ks, char *path, size_t len) {
+    spill_path(path, len, ks->dir, "run", ks->next_run++);
+    const int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        spill_fail("create", path);
+    }
+    unlink(path);
+    return fd;
+}
+
+static void ks_add_run(ks_partition_t *p, ks_run_t run) {
+    stats_resize(MEM_KEYS, p->n_runs * sizeof(ks_run_t),
+        (p->n_runs + 1) * sizeof(ks_run_t));
+    p->runs = (ks_run_t *) realloc(p->runs,
+        (p->n_runs + 1) * sizeof(ks_run_t));
+    assert(p->runs != NULL);
+    p->runs[p->n_runs++] = run;
+}
+
+// Merge all runs of partition into a single sorted run
+static void ks_merge(key_store_t *ks, ks_partition_t *p) {
+    const uint32_t n = p->n_runs;
+    assert(n <= KS_MERGE_FANIN);
+    // Split I/O buffer into one input window per run and one output
+    const uint32_t chunk = ks->io_cap / (n + 1);
+    uint32_t *in[KS_MERGE_FANIN], pos[KS_MERGE_FANIN], len[KS_MERGE_FANIN];
+    uint64_t next[KS_MERGE_FANIN];
+    uint32_t *out = ks->io_buf + n * chunk, out_len = 0;
+    char path[4096];
+    ks_run_t merged = {.fd = ks_open_run(ks, path, sizeof(path)),
+                       .count = 0, .common = ~0u};
+    uint32_t i;
+    for (i = 0; i < n; ++i) {
+        in[i] = ks->io_buf + i * chunk;
+        pos[i] = 0;
+        len[i] = 0;
+        next[i] = 0;
+        merged.common &= p->runs[i].common;
+    }
+    while (1) {
+        uint32_t best = n;
+        for (i = 0; i < n; ++i) {
+            if (pos[i] == len[i] && next[i] < p->runs[i].count) {
+                // Refill window of run i
+                const uint64_t left = p->runs[i].count - next[i];
+                len[i] = left < chunk ? (uint32_t) left : chunk;
+                read_all(p->runs[i].fd, in[i], len[i],
+                    next[i] * sizeof(uint32_t), "run");
+                next[i] += len[i];
+                pos[i] = 0;
+            }
+            if (pos[i] < len[i] &&
+                (best == n || in[i][pos[i]] < in[best][pos[best]])) {
+                best = i;
+            }
+        }
+        if (best == n) {
+            break;
+        }
+        out[out_len++] = in[best][pos[best]++];
+        if (out_len == chunk) {
+            write_all(merged.fd, out, out_len,
+                (uint64_t) merged.count * sizeof(uint32_t), path);
+            merged.count += out_len;
+            out_len = 0;
+        }
+    }
+    write_all(merged.fd, out, out_len,
+        (uint64_t) merged.count * sizeof(uint32_t), path);
+    merged.count += out_len;
+    for (i = 0; i < n; ++i) {
+        close(p->runs[i].fd);
+    }
+    // List of runs shrinks to the merged run
+    stats_free(MEM_KEYS, n * sizeof(ks_run_t));
+    p->n_runs = 0;
+    ks_add_run(p, merged);
+}
+
+// Write RAM buffer of partition as sorted run
+static void ks_flush(key_store_t *ks, ks_partition_t *p) {
+    qsort(p->keys, p->len, sizeof(uint32_t), compare_masks);
+    char path[4096];
+    ks_run_t run = {.fd = ks_open_run(ks, path, sizeof(path)),
+                    .count = p->len, .common = ~0u};
+    uint32_t i;
+    for (i = 0; i < p->len; ++i) {
+        run.common &= p->keys[i];
+    }
+    write_all(run.fd, p->keys, p->len, 0, path);
+    ks->ram_len -= p->len;
+    p->len = 0;
+    // Release buffer: capacity of all partitions stays below twice the
+    // keys they hold, whichever sizes passed through RAM before
+    stats_free(MEM_KEYS, p->cap * sizeof(uint32_t));
+    free(p->keys);
+    p->keys = NULL;
+    p->cap = 0;
+    ks_add_run(p, run);
+    if (p->n_runs == KS_MERGE_FANIN) {
+        ks_merge(ks, p);
+    }
+}
+
+CPU_DISPATCH_POPCNT
+void KS_insert(key_store_t *ks, uint32_t mask) {
+    if (ks->ram_len == ks->ram_cap) {
+        // Flush partition holding most keys in RAM
+        ks_partition_t *largest = &ks->part[0];
+        uint8_t s;
+        for (s = 1; s <= MAX_ATTRIBS; ++s) {
+            if (ks->part[s].len > largest->len) {
+                largest = &ks->part[s];
+            }
+        }
+        ks_flush(ks, largest);
+    }
+    ks_partition_t *p = &ks->part[__builtin_popcount(mask)];
+    if (p->len == p->cap) {
+        // No partition holds more than ram_cap keys
+        uint32_t cap = p->cap == 0 ? 64 : 2 * p->cap;
+        if (cap > ks->ram_cap) {
+            cap = ks->ram_cap;
+        }
+        stats_resize(MEM_KEYS, p->cap * sizeof(uint32_t),
+            cap * sizeof(uint32_t));
+        p->cap = cap;
+        p->keys = (uint32_t *) realloc(p->keys, p->cap * sizeof(uint32_t));
+        assert(p->keys != NULL);
+    }
+    p->keys[p->len++] = mask;
+    ++ks->ram_len;
+    ++ks->size;
+}
+
+// Index of first of n keys that is a subset of mask (n if none). Whole
+// blocks are tested without early exit so that the scan vectorizes.
+CPU_DISPATCH_SIMD
+static uint32_t find_subset(const uint32_t *keys, uint32_t n, uint32_t mask) {
+    const uint32_t outside = ~mask;
+    uint32_t i = 0, j;
+    for (; i + SCAN_BLOCK <= n; i += SCAN_BLOCK) {
+        uint32_t hit = 0;
+        for (j = 0; j < SCAN_BLOCK; ++j) {
+            hit |= (keys[i + j] & outside) == 0;
+        }
+        if (hit) {
+            break;
+        }
+    }
+    for (; i < n; ++i) {
+        if ((keys[i] & outside) == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Number of n sorted keys that are at most mask
+static uint32_t count_at_most(const uint32_t *keys, uint32_t n, uint32_t mask) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (keys[mid] <= mask) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Check if any stored key is a subset of mask
+CPU_DISPATCH_POPCNT
+uint8_t KS_contains_subset(key_store_t *ks, uint32_t mask) {
+    // Only keys with at most as many attributes can be subsets
+    const uint8_t size = (uint8_t) __builtin_popcount(mask);
+    uint8_t s;
+    uint32_t i, j;
+    for (s = 0; s <= size; ++s) {
+        const ks_partition_t *p = &ks->part[s];
+        i = find_subset(p->keys, p->len, mask);
+        if (i < p->len) {
+            STATS_ADD(containment_checks, i + 1);
+            return 1;
+        }
+        STATS_ADD(containment_checks, p->len);
+        for (i = 0; i < p->n_runs; ++i) {
+            const ks_run_t *run = &p->runs[i];
+            // Every key of run contains common attributes
+            if ((run->common & ~mask) != 0) {
+                continue;
+            }
+            ++ks->runs_read;
+            // Subsets of mask are numerically at most mask, so sorted
+            // runs are only scanned up to it
+            uint64_t next = 0;
+            while (next < run->count) {
+                const uint64_t left = run->count - next;
+                const uint32_t n = left < ks->io_cap ?
+                    (uint32_t) left : ks->io_cap;
+                read_all(run->fd, ks->io_buf, n, next * sizeof(uint32_t),
+                    "run");
+                const uint32_t end = count_at_most(ks->io_buf, n, mask);
+                j = find_subset(ks->io_buf, end, mask);
+                if (j < end) {
+                    STATS_ADD(containment_checks, j + 1);
+                    return 1;
+                }
+                STATS_ADD(containment_checks, end);
+                if (end < n) {
+                    break;
+                }
+                next += n;
+            }
+        }
+    }
+    return 0;
+}
+
+void KS_free(key_store_t *ks) {
+    uint8_t s;
+    uint32_t i;
+    for (s = 0; s <= MAX_ATTRIBS; ++s) {
+        ks_partition_t *p = &ks->part[s];
+        for (i = 0; i < p->n_runs; ++i) {
+            close(p->runs[i].fd);
+        }
+        stats_free(MEM_KEYS, p->n_runs * sizeof(ks_run_t) +
+            p->cap * sizeof(uint32_t));
+        free(p->runs);
+        free(p->keys);
+    }
+    stats_free(MEM_KEYS, ks->io_cap * sizeof(uint32_t));
+    free(ks->io_buf);
+    ks->size = 0;
+}
+
+static Set set_from_mask(uint32_t mask) {
+    Set s;
+    Set_init(&s);
+    s.set = mask;
+    s.size = (uint8_t) __builtin_popcount(mask);
+    return s;
+}
+
+// Share of budget in masks, at least min_buffer
+static uint32_t buffer_masks(uint64_t masks, uint32_t min_buffer) {
+    if (masks < min_buffer) {
+        return min_buffer;
+    }
+    return masks > UINT32_MAX ? UINT32_MAX : (uint32_t) masks;
+}
+
+// Print all candidate keys of functional dependencies in q using about
+// memory_budget bytes for work queue and keys, spilling to files in a
+// private directory below spill_dir; returns 0 on success
+int8_t print_all_candidate_keys_spill(const Queue *q, uint8_t n_attribs,
+    uint64_t memory_budget, uint32_t min_buffer, const char *spill_dir) {
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/func_dep-XXXXXX", spill_dir);
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Could not create spill directory in '%s'!\n",
+            spill_dir);
+        return 1;
+    }
+    active_dir = dir;
+    // Budget in masks: a quarter for both ends of the work queue, half
+    // for buffered keys (partition buffers may be up to twice as large
+    // as the keys they hold) and the rest for streaming runs
+    const uint64_t masks = memory_budget / sizeof(uint32_t);
+    spill_queue_t work;
+    key_store_t ckeys;
+    SQ_init(&work, dir, buffer_masks(masks / 8, min_buffer));
+    KS_init(&ckeys, dir, buffer_masks(masks / 4, min_buffer),
+        buffer_masks(masks / 4, min_buffer));
+
+    // Compute first ckey using all attributes
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    Set ckey = candidate_key_from_super_key(&attribs, q, n_attribs);
+    output_key(&ckey);
+    control_key_found();
+    KS_insert(&ckeys, ckey.set);
+    SQ_push(&work, ckey.set);
+    // Same iteration as in-memory Lucchesi-Osborn enumeration
+    // Work items are traced in batches of TRACE_BATCH
+    uint64_t batch = trace_start();
+    uint32_t batch_items = 0;
+    while (work.size != 0 && !control_poll(work.size)) {
+        if (batch_items == TRACE_BATCH) {
+            trace_end("work batch", batch);
+            batch = trace_start();
+            batch_items = 0;
+        }
+        ++batch_items;
+        const Set key = set_from_mask(SQ_pop(&work));
+        Q_iterator_t iter = Q_iterator(q);
+        while (iter) {
+            const Set diff = Set_difference(&key, &iter->key.rhs);
+            Set S = Set_union(&iter->key.lhs, &diff);
+            STATS_ADD(s_generated, 1);
+            perf_region_begin(PERF_REGION_SCAN);
+            const uint8_t contained = KS_contains_subset(&ckeys, S.set);
+            perf_region_end(PERF_REGION_SCAN);
+            if (!contained) {
+                if (control_key_found()) {
+                    break;
+                }
+                ckey = candidate_key_from_super_key(&S, q, n_attribs);
+                KS_insert(&ckeys, ckey.set);
+                SQ_push(&work, ckey.set);
+                output_key(&ckey);
+            } else {
+                STATS_ADD(s_rejected, 1);
+            }
+            iter = iter->next;
+        }
+    }
+    if (batch_items > 0) {
+        trace_end("work batch", batch);
+    }
+    output_flush();
+    printf("Number of candidate keys: %lu\n", (unsigned long) ckeys.size);
+    // Cleanup; run files are already unlinked
+    SQ_free(&work);
+    KS_free(&ckeys);
+    rmdir(dir);
+    active_dir = NULL;
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "stats.h"
+#include "perf.h"
+#include "trace.h"
+#include "control.h"
+#include "cpu.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <time.h>
+
+_Thread_local stats_counters_t stats_local;
+uint8_t stats_enabled = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static stats_counters_t totals;
+
+typedef struct {
+    double wall;        // accumulated seconds
+    double cpu;
+    double wall_start;  // start of current interval
+    double cpu_start;
+    uint64_t span;      // trace start of current interval
+} phase_t;
+
+static phase_t phases[STATS_N_PHASES];
+// Phase being timed and the phase it interrupted (-1: none). Output
+// runs inside enumeration; its time and hardware counts are not added
+// to the outer phase, so phase times add up to wall time.
+static int8_t current_phase = -1;
+static int8_t outer_phase = -1;
+static const char *phase_names[STATS_N_PHASES] = {
+    "parse", "preprocess", "enumerate", "output"
+};
+
+// Live and peak bytes per kind of memory; index MEM_N_KINDS is the
+// total over all kinds
+static atomic_uint_fast64_t mem_live[MEM_N_KINDS+1];
+static atomic_uint_fast64_t mem_peak[MEM_N_KINDS+1];
+static atomic_uint_fast64_t mem_allocs[MEM_N_KINDS];
+static const char *mem_names[MEM_N_KINDS] = {
+    "queue", "key store", "search", "zdd", "solver"
+};
+
+// Gaps between keys in log-linear buckets: values below GAP_SUB have
+// a bucket each, above that every power of two is split into GAP_SUB
+// buckets (relative error below 1/GAP_SUB)
+#define GAP_SUB_BITS 4
+#define GAP_SUB (1u << GAP_SUB_BITS)
+#define GAP_BUCKETS ((64 - GAP_SUB_BITS + 1) * GAP_SUB)
+
+static atomic_uint_fast64_t n_emitted;
+static atomic_uint_fast64_t first_key_ns;
+static atomic_uint_fast64_t last_key_ns;
+static atomic_uint_fast64_t max_gap_ns;
+static atomic_uint_fast64_t gap_counts[GAP_BUCKETS];
+
+const char *stats_phase_name(uint8_t phase) {
+    return phase_names[phase];
+}
+
+static double seconds(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (double) now.tv_sec + 1e-9 * (double) now.tv_nsec;
+}
+
+// Start/stop timing phase; time of repeated intervals adds up
+static void phase_resume(uint8_t phase) {
+    phases[phase].wall_start = seconds(CLOCK_MONOTONIC);
+    phases[phase].cpu_start = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    perf_phase_begin(phase);
+}
+
+static void phase_pause(uint8_t phase) {
+    perf_phase_end(phase);
+    phases[phase].wall += seconds(CLOCK_MONOTONIC) - phases[phase].wall_start;
+    phases[phase].cpu += seconds(CLOCK_PROCESS_CPUTIME_ID) -
+                         phases[phase].cpu_start;
+}
+
+void stats_phase_begin(uint8_t phase) {
+    phases[phase].span = trace_start();
+    if (current_phase >= 0) {
+        phase_pause((uint8_t) current_phase);
+        outer_phase = current_phase;
+    }
+    current_phase = (int8_t) phase;
+    phase_resume(phase);
+}
+
+void stats_phase_end(uint8_t phase) {
+    phase_pause(phase);
+    trace_end(phase_names[phase], phases[phase].span);
+    current_phase = outer_phase;
+    outer_phase = -1;
+    if (current_phase >= 0) {
+        phase_resume((uint8_t) current_phase);
+    }
+}
+
+static void raise_peak(uint8_t kind, uint64_t live) {
+    uint_fast64_t peak = atomic_load_explicit(&mem_peak[kind],
+        memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(
+               &mem_peak[kind], &peak, live, memory_order_relaxed,
+               memory_order_relaxed)) {
+    }
+}
+
+static void add_live(uint8_t kind, uint64_t bytes) {
+    raise_peak(kind, atomic_fetch_add_explicit(&mem_live[kind], bytes,
+        memory_order_relaxed) + bytes);
+    raise_peak(MEM_N_KINDS, atomic_fetch_add_explicit(&mem_live[MEM_N_KINDS],
+        bytes, memory_order_relaxed) + bytes);
+}
+
+static void sub_live(uint8_t kind, uint64_t bytes) {
+    atomic_fetch_sub_explicit(&mem_live[kind], bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&mem_live[MEM_N_KINDS], bytes,
+        memory_order_relaxed);
+}
+
+// Record allocation or release of bytes of kind
+void stats_alloc(uint8_t kind, uint64_t bytes) {
+    atomic_fetch_add_explicit(&mem_allocs[kind], 1, memory_order_relaxed);
+    add_live(kind, bytes);
+}
+
+void stats_free(uint8_t kind, uint64_t bytes) {
+    sub_live(kind, bytes);
+}
+
+void stats_resize(uint8_t kind, uint64_t old_bytes, uint64_t new_bytes) {
+    atomic_fetch_add_explicit(&mem_allocs[kind], 1, memory_order_relaxed);
+    if (new_bytes > old_bytes) {
+        add_live(kind, new_bytes - old_bytes);
+    } else {
+        sub_live(kind, old_bytes - new_bytes);
+    }
+}
+
+static uint32_t gap_bucket(uint64_t v) {
+    if (v < GAP_SUB) {
+        return (uint32_t) v;
+    }
+    const uint32_t exp = 63 - (uint32_t) __builtin_clzll(v);
+    return (exp - GAP_SUB_BITS + 1) * GAP_SUB +
+           (uint32_t)((v >> (exp - GAP_SUB_BITS)) & (GAP_SUB - 1));
+}
+
+// Smallest value of bucket
+static uint64_t gap_bucket_low(uint32_t b) {
+    if (b < GAP_SUB) {
+        return b;
+    }
+    const uint32_t exp = b / GAP_SUB + GAP_SUB_BITS - 1;
+    return (uint64_t)(GAP_SUB + b % GAP_SUB) << (exp - GAP_SUB_BITS);
+}
+
+// Record that n keys reached their file ns nanoseconds after
+// enumeration started (one write of a batch)
+void stats_keys_emitted(uint64_t n, uint64_t ns) {
+    if (n == 0) {
+        return;
+    }
+    const uint64_t index = atomic_fetch_add_explicit(&n_emitted, n,
+        memory_order_relaxed) + 1;
+    if (index == 1) {
+        atomic_store_explicit(&first_key_ns, ns, memory_order_relaxed);
+    }
+    const uint64_t prev = atomic_exchange_explicit(&last_key_ns, ns,
+        memory_order_relaxed);
+    // Keys of one batch arrive together
+    atomic_fetch_add_explicit(&gap_counts[0], n - 1, memory_order_relaxed);
+    if (index == 1) {
+        return;
+    }
+    const uint64_t gap = ns > prev ? ns - prev : 0;
+    atomic_fetch_add_explicit(&gap_counts[gap_bucket(gap)], 1,
+        memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&max_gap_ns, memory_order_relaxed);
+    while (gap > max && !atomic_compare_exchange_weak_explicit(&max_gap_ns,
+               &max, gap, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Gap at quantile q (lower end of its bucket)
+static uint64_t gap_quantile(uint64_t n_gaps, double q) {
+    uint64_t rank = (uint64_t)(q * (double) n_gaps + 0.999999), seen = 0;
+    uint32_t b;
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (b = 0; b < GAP_BUCKETS; ++b) {
+        seen += atomic_load(&gap_counts[b]);
+        if (seen >= rank) {
+            return gap_bucket_low(b);
+        }
+    }
+    return atomic_load(&max_gap_ns);
+}
+
+static void report_latency(void) {
+    const uint64_t keys = atomic_load(&n_emitted);
+    if (keys == 0) {
+        fprintf(stderr, "  time to first key:  (no keys written)\n");
+        return;
+    }
+    fprintf(stderr, "  time to first key:  %.6f s\n",
+        1e-9 * (double) atomic_load(&first_key_ns));
+    fprintf(stderr, "  time to last key:   %.6f s\n",
+        1e-9 * (double) atomic_load(&last_key_ns));
+    if (keys > 1) {
+        fprintf(stderr, "  key gaps [us]:      p50 %.3f, p99 %.3f, max %.3f\n",
+            1e-3 * (double) gap_quantile(keys - 1, 0.50),
+            1e-3 * (double) gap_quantile(keys - 1, 0.99),
+            1e-3 * (double) atomic_load(&max_gap_ns));
+    }
+}
+
+// Add counters of calling thread (including hardware counters of its
+// regions) to totals (call before thread exits)
+void stats_merge_thread(void) {
+    pthread_mutex_lock(&lock);
+    totals.closure_calls      += stats_local.closure_calls;
+    totals.fd_scans           += stats_local.fd_scans;
+    totals.superkey_tests     += stats_local.superkey_tests;
+    totals.containment_checks += stats_local.containment_checks;
+    totals.s_generated        += stats_local.s_generated;
+    totals.s_rejected         += stats_local.s_rejected;
+    if (stats_local.peak_queue > totals.peak_queue) {
+        totals.peak_queue = stats_local.peak_queue;
+    }
+    pthread_mutex_unlock(&lock);
+    stats_local = (stats_counters_t) {0};
+    perf_merge_thread();
+}
+
+// Print phase times, counter totals, key latency and memory use on
+// stderr
+void stats_report(void) {
+    stats_merge_thread();
+    uint8_t i;
+    fprintf(stderr, "Statistics:\n");
+    fprintf(stderr, "  %-12s %12s %12s\n", "phase", "wall [s]", "cpu [s]");
+    for (i = 0; i < STATS_N_PHASES; ++i) {
+        fprintf(stderr, "  %-12s %12.6f %12.6f\n", phase_names[i], phases[i].wall,
+            phases[i].cpu);
+    }
+    fprintf(stderr, "  closure calls:      %lu\n", (unsigned long) totals.closure_calls);
+    fprintf(stderr, "  FD scans:           %lu\n", (unsigned long) totals.fd_scans);
+    fprintf(stderr, "  super-key tests:    %lu\n", (unsigned long) totals.superkey_tests);
+    fprintf(stderr, "  containment checks: %lu\n", (unsigned long) totals.containment_checks);
+    fprintf(stderr, "  S generated:        %lu\n", (unsigned long) totals.s_generated);
+    fprintf(stderr, "  S rejected:         %lu\n", (unsigned long) totals.s_rejected);
+    fprintf(stderr, "  peak work queue:    %lu\n", (unsigned long) totals.peak_queue);
+    fprintf(stderr, "  CPU features:       %s\n", cpu_features());
+    report_latency();
+    fprintf(stderr, "  %-12s %12s %12s %12s\n", "memory", "live [B]",
+        "peak [B]", "allocations");
+    uint64_t allocs = 0;
+    for (i = 0; i < MEM_N_KINDS; ++i) {
+        const uint64_t n = atomic_load(&mem_allocs[i]);
+        allocs += n;
+        fprintf(stderr, "  %-12s %12lu %12lu %12lu\n", mem_names[i],
+            (unsigned long) atomic_load(&mem_live[i]),
+            (unsigned long) atomic_load(&mem_peak[i]), (unsigned long) n);
+    }
+    // Peak of total is at most sum of peaks of kinds
+    const uint64_t peak = atomic_load(&mem_peak[MEM_N_KINDS]);
+    fprintf(stderr, "  %-12s %12lu %12lu %12lu\n", "total",
+        (unsigned long) atomic_load(&mem_live[MEM_N_KINDS]),
+        (unsigned long) peak, (unsigned long) allocs);
+    // Peak per key found, for extrapolating to larger runs
+    const uint64_t keys = control_keys_found();
+    if (keys > 0) {
+        fprintf(stderr, "  peak bytes per key: %.1f\n", (double) peak / keys);
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        fprintf(stderr, "  peak RSS:           %ld KiB\n", usage.ru_maxrss);
+    }
+}
@@ -0,0 +1,179 @@
+#include "store.h"
+#include "set.h"
+#include "stats.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "FDKEYS01"
+
+// Keys collected for the result file being written
+static char *out_path = NULL;
+static uint8_t out_attribs = 0;
+static uint32_t *masks = NULL;
+static uint64_t n_masks = 0, cap_masks = 0;
+
+// Start collecting keys for file at path
+void store_begin(const char *path, uint8_t n_attribs) {
+    const size_t len = strlen(path);
+    out_path = (char *) malloc(len + 1);
+    assert(out_path != NULL);
+    memcpy(out_path, path, len + 1);
+    out_attribs = n_attribs;
+    n_masks = 0;
+    cap_masks = 1024;
+    masks = (uint32_t *) malloc(cap_masks * sizeof(uint32_t));
+    assert(masks != NULL);
+    stats_alloc(MEM_KEYS, cap_masks * sizeof(uint32_t));
+}
+
+// Add key (no-op unless collecting)
+void store_add(uint32_t mask) {
+    if (masks == NULL) {
+        return;
+    }
+    if (n_masks == cap_masks) {
+        stats_resize(MEM_KEYS, cap_masks * sizeof(uint32_t),
+            2 * cap_masks * sizeof(uint32_t));
+        cap_masks *= 2;
+        masks = (uint32_t *) realloc(masks, cap_masks * sizeof(uint32_t));
+        assert(masks != NULL);
+    }
+    masks[n_masks++] = mask;
+}
+
+static int8_t write_bytes(FILE *fp, const void *data, size_t len) {
+    return fwrite(data, 1, len, fp) == len ? 0 : 1;
+}
+
+// Write collected keys atomically; returns 0 on success
+int8_t store_end(void) {
+    if (masks == NULL) {
+        return 0;
+    }
+    store_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.n_attribs = out_attribs;
+    h.n_keys = n_masks;
+    h.masks_offset = sizeof(h);
+    // Postings start 8 byte aligned after masks
+    h.postings_offset = (h.masks_offset + n_masks * sizeof(uint32_t) + 7) &
+                        ~(uint64_t) 7;
+    h.posting_words = (n_masks + 63) / 64;
+    
+    // Build all posting bitmaps in one pass over the keys
+    const size_t n_words = (size_t) out_attribs * h.posting_words;
+    uint64_t *postings = (uint64_t *) calloc(n_words ? n_words : 1,
+        sizeof(uint64_t));
+    assert(postings != NULL);
+    stats_alloc(MEM_KEYS, n_words * sizeof(uint64_t));
+    uint64_t i;
+    for (i = 0; i < n_masks; ++i) {
+        uint32_t bits = masks[i];
+        while (bits) {
+            const uint8_t a = (uint8_t) __builtin_ctz(bits);
+            postings[a * h.posting_words + i / 64] |= 1ull << (i % 64);
+            bits &= bits - 1;
+        }
+    }
+    
+    // Same atomic replacement as for checkpoints
+    const size_t len = strlen(out_path);
+    char *tmp_path = (char *) malloc(len + 5);
+    assert(tmp_path != NULL);
+    memcpy(tmp_path, out_path, len);
+    memcpy(tmp_path + len, ".tmp", 5);
+    static const uint8_t zeros[8] = {0};
+    FILE *fp = fopen(tmp_path, "wb");
+    int8_t ierr = fp == NULL;
+    ierr = ierr || write_bytes(fp, &h, sizeof(h));
+    ierr = ierr || write_bytes(fp, masks, n_masks * sizeof(uint32_t));
+    ierr = ierr || write_bytes(fp, zeros, h.postings_offset -
+        (h.masks_offset + n_masks * sizeof(uint32_t)));
+    ierr = ierr || write_bytes(fp, postings, n_words * sizeof(uint64_t));
+    ierr = ierr || fflush(fp) != 0 || fsync(fileno(fp)) != 0;
+    if (fp != NULL) {
+        ierr = (fclose(fp) != 0) || ierr;
+    }
+    ierr = ierr || rename(tmp_path, out_path) != 0;
+    if (ierr) {
+        fprintf(stderr, "Could not write result file '%s'!\n", out_path);
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    stats_free(MEM_KEYS, n_words * sizeof(uint64_t) +
+        cap_masks * sizeof(uint32_t));
+    free(postings);
+    free(masks);
+    free(out_path);
+    masks = NULL;
+    out_path = NULL;
+    return ierr;
+}
+
+// Reading: map file at path; returns 0 on success
+int8_t store_map(store_t *st, const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open result file at '%s'!\n", path);
+        return 1;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < sizeof(store_header_t)) {
+        fprintf(stderr, "'%s' is not a result file\n", path);
+        close(fd);
+        return 1;
+    }
+    st->length = (size_t) sb.st_size;
+    st->base = mmap(NULL, st->length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (st->base == MAP_FAILED) {
+        fprintf(stderr, "Could not map result file '%s'!\n", path);
+        return 1;
+    }
+    st->header = (const store_header_t *) st->base;
+    const store_header_t *h = st->header;
+    // All sections must lie within the file. Counts and offsets are
+    // bounded by the file length first, so the sums below cannot wrap.
+    uint8_t valid = memcmp(h->magic, MAGIC, sizeof(h->magic)) == 0 &&
+        h->n_attribs <= MAX_ATTRIBS &&
+        h->n_keys <= st->length / sizeof(uint32_t) &&
+        h->posting_words == (h->n_keys + 63) / 64 &&
+        h->masks_offset >= sizeof(*h) && h->masks_offset <= st->length &&
+        h->masks_offset % sizeof(uint32_t) == 0 &&
+        h->postings_offset <= st->length && h->postings_offset % 8 == 0 &&
+        h->masks_offset + h->n_keys * sizeof(uint32_t) <= h->postings_offset &&
+        h->n_attribs * h->posting_words * sizeof(uint64_t) <=
+            st->length - h->postings_offset;
+    if (valid) {
+        st->masks = (const uint32_t *)((const char *) st->base +
+                                       h->masks_offset);
+        st->postings = (const uint64_t *)
+            ((const char *) st->base + h->postings_offset);
+        // Keys may only contain attributes of the file
+        const uint32_t all = (1u << h->n_attribs) - 1;
+        uint64_t i;
+        for (i = 0; i < h->n_keys && valid; ++i) {
+            valid = (st->masks[i] & ~all) == 0;
+        }
+    }
+    if (!valid) {
+        fprintf(stderr, "'%s' is not a valid result file\n", path);
+        munmap(st->base, st->length);
+        return 1;
+    }
+    return 0;
+}
+
+void store_unmap(store_t *st) {
+    munmap(st->base, st->length);
+    st->base = NULL;
+}
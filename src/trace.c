@@ -0,0 +1,144 @@
+#include "trace.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+// Events per chunk and chunks per thread; spans beyond are dropped
+#define TRACE_CHUNK 4096u
+#define TRACE_MAX_CHUNKS 256u
+
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} trace_event_t;
+
+typedef struct trace_chunk {
+    struct trace_chunk *next;
+    uint32_t len;
+    trace_event_t events[TRACE_CHUNK];
+} trace_chunk_t;
+
+// Spans of one thread, only appended to by that thread
+typedef struct trace_buffer {
+    struct trace_buffer *next;
+    uint32_t tid;
+    uint32_t n_chunks;
+    uint64_t dropped;
+    trace_chunk_t *first;
+    trace_chunk_t *last;
+} trace_buffer_t;
+
+uint8_t trace_enabled = 0;
+
+static const char *trace_path = NULL;
+static uint64_t origin = 0;
+static _Atomic(trace_buffer_t *) buffers = NULL;
+static atomic_uint next_tid = 0;
+static _Thread_local trace_buffer_t *local = NULL;
+
+// Nanoseconds on monotonic clock
+uint64_t trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+// Enable tracing; spans are written to path by trace_write
+void trace_init(const char *path) {
+    trace_path = path;
+    origin = trace_now();
+    trace_enabled = 1;
+}
+
+// Create buffer of calling thread and push it onto global list
+static trace_buffer_t *register_thread(void) {
+    trace_buffer_t *b = (trace_buffer_t *) calloc(1, sizeof(trace_buffer_t));
+    assert(b != NULL);
+    b->tid = atomic_fetch_add(&next_tid, 1);
+    b->next = atomic_load(&buffers);
+    while (!atomic_compare_exchange_weak(&buffers, &b->next, b)) {
+    }
+    return b;
+}
+
+// Append span from start (as returned by trace_start) to now
+void trace_record(const char *name, uint64_t start) {
+    const uint64_t end = trace_now();
+    if (local == NULL) {
+        local = register_thread();
+    }
+    trace_buffer_t *b = local;
+    if (b->last == NULL || b->last->len == TRACE_CHUNK) {
+        if (b->n_chunks == TRACE_MAX_CHUNKS) {
+            ++b->dropped;
+            return;
+        }
+        trace_chunk_t *c = (trace_chunk_t *) malloc(sizeof(trace_chunk_t));
+        assert(c != NULL);
+        c->next = NULL;
+        c->len = 0;
+        if (b->last != NULL) {
+            b->last->next = c;
+        } else {
+            b->first = c;
+        }
+        b->last = c;
+        ++b->n_chunks;
+    }
+    b->last->events[b->last->len++] = (trace_event_t) {name, start, end};
+}
+
+// Write all spans as JSON; returns 0 on success. Must be called after
+// all traced threads have finished.
+int8_t trace_write(void) {
+    if (!trace_enabled) {
+        return 0;
+    }
+    FILE *fp = fopen(trace_path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write trace to '%s'!\n", trace_path);
+        return 1;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const char *sep = "";
+    trace_buffer_t *b = atomic_load(&buffers), *next;
+    for (; b != NULL; b = next) {
+        next = b->next;
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", sep, b->tid,
+            b->tid);
+        sep = ",\n";
+        if (b->dropped > 0) {
+            fprintf(stderr, "Trace buffer of thread %u full, dropped %lu "
+                "spans\n", b->tid, (unsigned long) b->dropped);
+        }
+        trace_chunk_t *c = b->first, *next_chunk;
+        for (; c != NULL; c = next_chunk) {
+            next_chunk = c->next;
+            uint32_t i;
+            for (i = 0; i < c->len; ++i) {
+                const trace_event_t *e = &c->events[i];
+                // Timestamps in microseconds since tracing started
+                fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                    "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e->name, b->tid,
+                    (double)(e->start - origin) * 1e-3,
+                    (double)(e->end - e->start) * 1e-3);
+            }
+            free(c);
+        }
+        free(b);
+    }
+    fprintf(fp, "\n]}\n");
+    atomic_store(&buffers, NULL);
+    local = NULL;
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "Could not write trace to '%s'!\n", trace_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "weighted.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "output.h"
+#include "stats.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct {
+    const Queue *q;
+    uint8_t n_attribs;
+    const uint32_t *weights;     // NULL for unit weights
+    const key_constraints_t *c;
+    uint32_t k;
+    uint32_t n_found;
+    Set *keys;        // best keys so far, sorted by weight
+    uint64_t *costs;
+} bb_t;
+
+static uint64_t set_weight(const bb_t *bb, const Set *s) {
+    if (bb->weights == NULL) {
+        return s->size;
+    }
+    uint64_t w = 0;
+    uint32_t bits = s->set;
+    while (bits) {
+        w += bb->weights[__builtin_ctz(bits)];
+        bits &= bits - 1;
+    }
+    return w;
+}
+
+// Insert key into sorted list of best keys (at most k)
+static void record_key(bb_t *bb, const Set *key) {
+    const uint64_t cost = set_weight(bb, key);
+    uint32_t i = bb->n_found;
+    if (i == bb->k) {
+        if (cost >= bb->costs[i - 1]) {
+            return;
+        }
+        --i;  // drop most expensive key
+    } else {
+        ++bb->n_found;
+    }
+    while (i > 0 && bb->costs[i - 1] > cost) {
+        bb->keys[i] = bb->keys[i - 1];
+        bb->costs[i] = bb->costs[i - 1];
+        --i;
+    }
+    bb->keys[i] = *key;
+    bb->costs[i] = cost;
+}
+
+static void branch_and_bound(bb_t *bb, Set in, Set out) {
+    for (;;) {
+        if (control_poll(bb->n_found)) {
+            return;  // keep best keys found so far
+        }
+        const uint8_t status = propagate_key_decisions(&in, &out, bb->q,
+                                                       bb->n_attribs);
+        if (!key_constraints_admit(bb->c, &in, status)) {
+            return;
+        }
+        if (status == NODE_KEY) {
+            record_key(bb, &in);
+            return;
+        }
+        uint8_t attrib;
+        const uint64_t bound = key_weight_lower_bound(&in, &out, bb->q,
+                                   bb->n_attribs, bb->weights, &attrib);
+        if (bb->n_found == bb->k && bound >= bb->costs[bb->k - 1]) {
+            return;  // cannot improve on k best keys found so far
+        }
+        if (bb->c->max_size < MAX_ATTRIBS) {
+            uint8_t unused;
+            if (key_weight_lower_bound(&in, &out, bb->q, bb->n_attribs, NULL,
+                                       &unused) > bb->c->max_size) {
+                return;  // every key of subtree is too large
+            }
+        }
+        // Include cheapest attribute of first cut, then exclude it
+        Set with = in;
+        Set_insert(&with, attrib);
+        branch_and_bound(bb, with, out);
+        Set_insert(&out, attrib);
+    }
+}
+
+// Find up to k candidate keys of least total weight; stores them in
+// nondecreasing order of weight and returns number of keys found
+uint32_t min_weight_keys(const Queue *q, uint8_t n_attribs,
+    const uint32_t weights[MAX_ATTRIBS], const key_constraints_t *c, uint32_t k,
+    Set *keys, uint64_t *costs) {
+    
+    assert(k > 0);
+    bb_t bb = {.q = q, .n_attribs = n_attribs, .weights = weights, .c = c,
+               .k = k, .n_found = 0, .keys = keys, .costs = costs};
+    branch_and_bound(&bb, c->include, c->exclude);
+    return bb.n_found;
+}
+
+// Print up to k candidate keys of least total weight
+void print_min_weight_keys(const Queue *q, uint8_t n_attribs,
+    const uint32_t weights[MAX_ATTRIBS], const key_constraints_t *c, uint32_t k) {
+    
+    Set *keys = (Set *) malloc(k * sizeof(Set));
+    uint64_t *costs = (uint64_t *) malloc(k * sizeof(uint64_t));
+    assert(keys != NULL && costs != NULL);
+    
+    const uint32_t n_found = min_weight_keys(q, n_attribs, weights, c,
+                                                k, keys, costs);
+    uint32_t i;
+    for (i = 0; i < n_found; ++i) {
+        output_key(&keys[i]);
+    }
+    output_flush();
+    // Weights in order of keys; report output, not part of key stream
+    printf("Key weights:");
+    for (i = 0; i < n_found; ++i) {
+        printf(" %lu", (unsigned long) costs[i]);
+    }
+    printf("\nNumber of candidate keys: %u\n", n_found);
+    free(keys);
+    free(costs);
+}
+
+// Node of best-first search, ordered by bound with keys first on ties
+typedef struct {
+    Set in;
+    Set out;
+    uint64_t bound;
+    uint8_t is_key;
+    uint8_t branch;  // attribute to branch on for open nodes
+} ranked_node_t;
+
+typedef struct {
+    ranked_node_t *nodes;
+    uint32_t size;
+    uint32_t capacity;
+} node_heap_t;
+
+static uint8_t node_less(const ranked_node_t *a, const ranked_node_t *b) {
+    return a->bound < b->bound || (a->bound == b->bound && a->is_key > b->is_key);
+}
+
+static void heap_push(node_heap_t *h, ranked_node_t node) {
+    if (h->size == h->capacity) {
+        stats_resize(MEM_SEARCH, h->capacity * sizeof(ranked_node_t),
+            (h->capacity ? 2 * h->capacity : 64) * sizeof(ranked_node_t));
+        h->capacity = h->capacity ? 2 * h->capacity : 64;
+        h->nodes = (ranked_node_t *) realloc(h->nodes,
+                                       h->capacity * sizeof(ranked_node_t));
+        assert(h->nodes != NULL);
+    }
+    uint32_t i = h->size++;
+    while (i > 0 && node_less(&node, &h->nodes[(i - 1) / 2])) {
+        h->nodes[i] = h->nodes[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->nodes[i] = node;
+}
+
+static ranked_node_t heap_pop(node_heap_t *h) {
+    assert(h->size > 0);
+    const ranked_node_t top = h->nodes[0];
+    const ranked_node_t last = h->nodes[--h->size];
+    uint32_t i = 0, child;
+    while ((child = 2 * i + 1) < h->size) {
+        if (child + 1 < h->size && node_less(&h->nodes[child + 1], &h->nodes[child])) {
+            ++child;
+        }
+        if (!node_less(&h->nodes[child], &last)) {
+            break;
+        }
+        h->nodes[i] = h->nodes[child];
+        i = child;
+    }
+    h->nodes[i] = last;
+    return top;
+}
+
+// Propagate decisions of child node and queue it with its bound
+static void push_child(const bb_t *bb, node_heap_t *h, Set in, Set out) {
+    const uint8_t status = propagate_key_decisions(&in, &out, bb->q,
+                                                   bb->n_attribs);
+    if (!key_constraints_admit(bb->c, &in, status)) {
+        return;
+    }
+    ranked_node_t node = {.in = in, .out = out, .is_key = status == NODE_KEY,
+                          .branch = INVALID_ATTRIB};
+    if (node.is_key) {
+        node.bound = set_weight(bb, &in);
+    } else {
+        node.bound = key_weight_lower_bound(&in, &out, bb->q, bb->n_attribs,
+                                            bb->weights, &node.branch);
+    }
+    if (node.bound > bb->c->max_size) {
+        return;  // every key of subtree is too large
+    }
+    heap_push(h, node);
+}
+
+// Print candidate keys satisfying constraints in nondecreasing size;
+// stops after max_keys keys (0: no limit)
+void print_keys_ranked(const Queue *q, uint8_t n_attribs,
+    const key_constraints_t *c, uint32_t max_keys) {
+    
+    bb_t bb = {.q = q, .n_attribs = n_attribs, .weights = NULL, .c = c};
+    node_heap_t heap = {.nodes = NULL, .size = 0, .capacity = 0};
+    push_child(&bb, &heap, c->include, c->exclude);
+    
+    uint32_t n_keys = 0;
+    uint8_t stopped = 0;
+    while (heap.size > 0 && !control_poll(heap.size)) {
+        if (max_keys != 0 && n_keys == max_keys) {
+            stopped = 1;
+            break;
+        }
+        ranked_node_t node = heap_pop(&heap);
+        if (node.is_key) {
+            // No open node can lead to a lighter key
+            if (control_key_found()) {
+                break;
+            }
+            output_key(&node.in);
+            ++n_keys;
+            continue;
+        }
+        Set with = node.in;
+        Set_insert(&with, node.branch);
+        push_child(&bb, &heap, with, node.out);
+        Set_insert(&node.out, node.branch);
+        push_child(&bb, &heap, node.in, node.out);
+    }
+    output_flush();
+    printf("Number of candidate keys: %u\n", n_keys);
+    if (stopped) {
+        printf("Enumeration stopped early, more candidate keys may exist\n");
+    }
+    stats_free(MEM_SEARCH, heap.capacity * sizeof(ranked_node_t));
+    free(heap.nodes);
+}
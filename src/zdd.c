@@ -0,0 +1,400 @@
+#include "zdd.h"
+#include "fd.h"
+#include "set.h"
+#include "queue.h"
+#include "control.h"
+#include "stats.h"
+#include "perf.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INITIAL_NODES (1u << 12)
+#define INITIAL_CACHE (1u << 14)
+#define MAX_CACHE     (1u << 22)
+
+// Operation codes for cache
+enum {
+    OP_NONE = 0,
+    OP_UNION,
+    OP_ONSET,
+    OP_SUPERSETS,
+    OP_HAS_SUBSET
+};
+
+static uint32_t hash3(uint32_t a, uint32_t b, uint32_t c) {
+    uint64_t h = a * 0x9E3779B97F4A7C15ull;
+    h ^= b + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+    h ^= c + 0x94D049BB133111EBull + (h << 6) + (h >> 2);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static void unique_insert(Zdd *z, zdd_t id) {
+    const zdd_node_t *n = &z->nodes[id];
+    uint32_t slot = hash3(n->var, n->lo, n->hi) & z->unique_mask;
+    while (z->unique[slot] != ZDD_EMPTY) {
+        slot = (slot + 1) & z->unique_mask;
+    }
+    z->unique[slot] = id;
+}
+
+// Bytes of node, count, unique and cache tables
+static uint64_t zdd_bytes(const Zdd *z) {
+    return (uint64_t) z->capacity * (sizeof(zdd_node_t) + sizeof(uint64_t)) +
+           (uint64_t)(z->unique_mask + 1) * sizeof(zdd_t) +
+           (uint64_t)(z->cache_mask + 1) * sizeof(zdd_cache_entry_t);
+}
+
+static void grow(Zdd *z) {
+    const uint64_t old_bytes = zdd_bytes(z);
+    z->capacity *= 2;
+    z->nodes = (zdd_node_t *) realloc(z->nodes, z->capacity * sizeof(zdd_node_t));
+    z->counts = (uint64_t *) realloc(z->counts, z->capacity * sizeof(uint64_t));
+    assert(z->nodes != NULL && z->counts != NULL);
+    // Rehash unique table at twice the node capacity (load <= 1/2)
+    free(z->unique);
+    z->unique_mask = 2 * z->capacity - 1;
+    z->unique = (zdd_t *) calloc(z->unique_mask + 1, sizeof(zdd_t));
+    assert(z->unique != NULL);
+    uint32_t i;
+    for (i = 2; i < z->size; ++i) {
+        unique_insert(z, i);
+    }
+    // Grow cache with number of nodes (entries are dropped)
+    if (z->cache_mask + 1 < MAX_CACHE) {
+        free(z->cache);
+        z->cache_mask = 2 * (z->cache_mask + 1) - 1;
+        z->cache = (zdd_cache_entry_t *) calloc(z->cache_mask + 1,
+                                                sizeof(zdd_cache_entry_t));
+        assert(z->cache != NULL);
+    }
+    stats_resize(MEM_ZDD, old_bytes, zdd_bytes(z));
+}
+
+// Find or create node; applies zero-suppression rule
+static zdd_t get_node(Zdd *z, uint8_t var, zdd_t lo, zdd_t hi) {
+    if (hi == ZDD_EMPTY) {
+        return lo;
+    }
+    uint32_t slot = hash3(var, lo, hi) & z->unique_mask;
+    zdd_t id;
+    while ((id = z->unique[slot]) != ZDD_EMPTY) {
+        const zdd_node_t *n = &z->nodes[id];
+        if (n->var == var && n->lo == lo && n->hi == hi) {
+            return id;
+        }
+        slot = (slot + 1) & z->unique_mask;
+    }
+    if (z->size == z->capacity) {
+        grow(z);
+    }
+    id = z->size++;
+    z->nodes[id] = (zdd_node_t) {.var = var, .lo = lo, .hi = hi};
+    z->counts[id] = UINT64_MAX;
+    unique_insert(z, id);
+    return id;
+}
+
+static uint8_t cache_lookup(const Zdd *z, uint32_t op, uint32_t a, uint32_t b,
+    zdd_t *result) {
+    
+    const zdd_cache_entry_t *e = &z->cache[hash3(op, a, b) & z->cache_mask];
+    if (e->op == op && e->a == a && e->b == b) {
+        *result = e->result;
+        return 1;
+    }
+    return 0;
+}
+
+static void cache_store(Zdd *z, uint32_t op, uint32_t a, uint32_t b,
+    zdd_t result) {
+    
+    zdd_cache_entry_t *e = &z->cache[hash3(op, a, b) & z->cache_mask];
+    *e = (zdd_cache_entry_t) {.op = op, .a = a, .b = b, .result = result};
+}
+
+// Initialize ZDD manager
+void Zdd_init(Zdd *z) {
+    z->capacity = INITIAL_NODES;
+    z->nodes = (zdd_node_t *) malloc(z->capacity * sizeof(zdd_node_t));
+    z->counts = (uint64_t *) malloc(z->capacity * sizeof(uint64_t));
+    z->unique_mask = 2 * z->capacity - 1;
+    z->unique = (zdd_t *) calloc(z->unique_mask + 1, sizeof(zdd_t));
+    z->cache_mask = INITIAL_CACHE - 1;
+    z->cache = (zdd_cache_entry_t *) calloc(INITIAL_CACHE,
+                                            sizeof(zdd_cache_entry_t));
+    assert(z->nodes != NULL && z->counts != NULL);
+    assert(z->unique != NULL && z->cache != NULL);
+    stats_alloc(MEM_ZDD, zdd_bytes(z));
+    // Terminals carry invalid variable so they sort below all nodes
+    z->nodes[ZDD_EMPTY] = (zdd_node_t) {.var = INVALID_ATTRIB,
+                                        .lo = ZDD_EMPTY, .hi = ZDD_EMPTY};
+    z->nodes[ZDD_BASE]  = (zdd_node_t) {.var = INVALID_ATTRIB,
+                                        .lo = ZDD_BASE, .hi = ZDD_BASE};
+    z->counts[ZDD_EMPTY] = 0;
+    z->counts[ZDD_BASE]  = 1;
+    z->size = 2;
+}
+
+// Free ZDD manager
+void Zdd_free(Zdd *z) {
+    stats_free(MEM_ZDD, zdd_bytes(z));
+    free(z->nodes);
+    free(z->counts);
+    free(z->unique);
+    free(z->cache);
+    memset(z, 0, sizeof(Zdd));
+}
+
+// Family containing exactly the set s
+zdd_t Zdd_singleton(Zdd *z, const Set *s) {
+    zdd_t f = ZDD_BASE;
+    int8_t i;
+    // Build chain bottom-up (largest attribute first)
+    for (i = MAX_ATTRIBS - 1; i >= 0; --i) {
+        if (s->set & (1u << i)) {
+            f = get_node(z, (uint8_t) i, ZDD_EMPTY, f);
+        }
+    }
+    return f;
+}
+
+// Union of two families
+zdd_t Zdd_union(Zdd *z, zdd_t f, zdd_t g) {
+    if (f == ZDD_EMPTY || f == g) return g;
+    if (g == ZDD_EMPTY) return f;
+    if (f > g) {
+        // Commutative: normalize operand order for cache
+        zdd_t t = f; f = g; g = t;
+    }
+    zdd_t r;
+    if (cache_lookup(z, OP_UNION, f, g, &r)) {
+        return r;
+    }
+    const zdd_node_t nf = z->nodes[f], ng = z->nodes[g];
+    if (nf.var < ng.var) {
+        r = get_node(z, nf.var, Zdd_union(z, nf.lo, g), nf.hi);
+    } else if (nf.var > ng.var) {
+        r = get_node(z, ng.var, Zdd_union(z, f, ng.lo), ng.hi);
+    } else {
+        const zdd_t lo = Zdd_union(z, nf.lo, ng.lo);
+        const zdd_t hi = Zdd_union(z, nf.hi, ng.hi);
+        r = get_node(z, nf.var, lo, hi);
+    }
+    cache_store(z, OP_UNION, f, g, r);
+    return r;
+}
+
+// Sets of f containing attribute i
+zdd_t Zdd_onset(Zdd *z, zdd_t f, uint8_t i) {
+    const zdd_node_t nf = z->nodes[f];
+    if (nf.var > i) {
+        return ZDD_EMPTY;  // includes terminals
+    }
+    zdd_t r;
+    if (cache_lookup(z, OP_ONSET, f, i, &r)) {
+        return r;
+    }
+    if (nf.var == i) {
+        r = get_node(z, i, ZDD_EMPTY, nf.hi);
+    } else {
+        r = get_node(z, nf.var, Zdd_onset(z, nf.lo, i), Zdd_onset(z, nf.hi, i));
+    }
+    cache_store(z, OP_ONSET, f, i, r);
+    return r;
+}
+
+// Supersets of members of f using only attributes from var up to n
+static zdd_t supersets(Zdd *z, zdd_t f, uint8_t var, uint8_t n_attribs) {
+    if (f == ZDD_EMPTY || var == n_attribs) {
+        return f;
+    }
+    zdd_t r;
+    if (cache_lookup(z, OP_SUPERSETS, f, var, &r)) {
+        return r;
+    }
+    const zdd_node_t nf = z->nodes[f];
+    if (nf.var > var) {
+        // Attribute var is unconstrained
+        const zdd_t rest = supersets(z, f, var + 1, n_attribs);
+        r = get_node(z, var, rest, rest);
+    } else {
+        const zdd_t lo = supersets(z, nf.lo, var + 1, n_attribs);
+        const zdd_t both = Zdd_union(z, nf.lo, nf.hi);
+        const zdd_t hi = supersets(z, both, var + 1, n_attribs);
+        r = get_node(z, var, lo, hi);
+    }
+    cache_store(z, OP_SUPERSETS, f, var, r);
+    return r;
+}
+
+// All supersets over n_attribs attributes of sets in f
+zdd_t Zdd_supersets(Zdd *z, zdd_t f, uint8_t n_attribs) {
+    assert(n_attribs <= MAX_ATTRIBS);
+    return supersets(z, f, 0, n_attribs);
+}
+
+// Number of sets in family
+uint64_t Zdd_count(Zdd *z, zdd_t f) {
+    if (z->counts[f] != UINT64_MAX) {
+        return z->counts[f];
+    }
+    const zdd_node_t nf = z->nodes[f];
+    const uint64_t c = Zdd_count(z, nf.lo) + Zdd_count(z, nf.hi);
+    z->counts[f] = c;
+    return c;
+}
+
+// Check if set s is a member of family
+uint8_t Zdd_contains(const Zdd *z, zdd_t f, const Set *s) {
+    uint32_t remaining = s->set;
+    while (f > ZDD_BASE) {
+        const zdd_node_t *n = &z->nodes[f];
+        const uint32_t bit = 1u << n->var;
+        // Attribute of s below var can no longer be matched
+        if (remaining & (bit - 1)) {
+            return 0;
+        }
+        if (remaining & bit) {
+            remaining ^= bit;
+            f = n->hi;
+        } else {
+            f = n->lo;
+        }
+    }
+    return f == ZDD_BASE && remaining == 0;
+}
+
+// Check if family has some member that is a subset of s
+uint8_t Zdd_has_subset(Zdd *z, zdd_t f, const Set *s) {
+    if (f <= ZDD_BASE) {
+        return f == ZDD_BASE;
+    }
+    zdd_t r;
+    if (cache_lookup(z, OP_HAS_SUBSET, f, s->set, &r)) {
+        return (uint8_t) r;
+    }
+    const zdd_node_t nf = z->nodes[f];
+    r = Zdd_has_subset(z, nf.lo, s);
+    if (!r && (s->set & (1u << nf.var))) {
+        r = Zdd_has_subset(z, nf.hi, s);
+    }
+    cache_store(z, OP_HAS_SUBSET, f, s->set, r);
+    return (uint8_t) r;
+}
+
+// Descend from node, preferring lo edges, until terminal is reached
+static void iterator_descend(Zdd_iterator *it, zdd_t f) {
+    while (f > ZDD_BASE) {
+        const zdd_node_t *n = &it->z->nodes[f];
+        it->path[it->depth] = f;
+        if (n->lo != ZDD_EMPTY) {
+            it->took_hi[it->depth++] = 0;
+            f = n->lo;
+        } else {
+            it->took_hi[it->depth++] = 1;
+            it->current |= 1u << n->var;
+            f = n->hi;
+        }
+    }
+}
+
+// Lazily enumerate members of family
+void Zdd_iterator_init(Zdd_iterator *it, const Zdd *z, zdd_t f) {
+    it->z = z;
+    it->depth = 0;
+    it->started = 0;
+    it->current = 0;
+    it->root = f;
+}
+
+// Store next member in s; returns 0 once all members were visited
+uint8_t Zdd_iterator_next(Zdd_iterator *it, Set *s) {
+    if (!it->started) {
+        it->started = 1;
+        if (it->root == ZDD_EMPTY) {
+            return 0;
+        }
+        iterator_descend(it, it->root);
+    } else {
+        // Backtrack to deepest node whose hi edge is unexplored
+        for (;;) {
+            if (it->depth == 0) {
+                return 0;
+            }
+            const uint8_t d = it->depth - 1;
+            const zdd_node_t *n = &it->z->nodes[it->path[d]];
+            if (!it->took_hi[d]) {
+                it->took_hi[d] = 1;
+                it->current |= 1u << n->var;
+                iterator_descend(it, n->hi);
+                break;
+            }
+            it->current &= ~(1u << n->var);
+            --it->depth;
+        }
+    }
+    Set_init(s);
+    s->set = it->current;
+    s->size = __builtin_popcount(it->current);
+    return 1;
+}
+
+// From paper: Candidate Keys for Relations (Lucchesi and Osborn), with
+// the list of found candidate keys replaced by a ZDD
+zdd_t Zdd_candidate_keys(Zdd *z, const Queue *q, uint8_t n_attribs) {
+    Queue work;
+    Q_init(&work);
+    
+    Set attribs;
+    Set_full(&attribs, n_attribs);
+    Set ckey = candidate_key_from_super_key(&attribs, q, n_attribs);
+    zdd_t ckeys = Zdd_singleton(z, &ckey);
+    Q_insert(&work, (q_key_t) {.lhs = ckey, .rhs = (Set) {0}});
+    control_key_found();
+    
+    // Work items are traced in batches of TRACE_BATCH
+    uint64_t batch = trace_start();
+    uint32_t batch_items = 0;
+    while (work.size != 0 && !control_poll(work.size)) {
+        if (batch_items == TRACE_BATCH) {
+            trace_end("work batch", batch);
+            batch = trace_start();
+            batch_items = 0;
+        }
+        ++batch_items;
+        const q_key_t key = Q_pop(&work);
+        Q_iterator_t iter = Q_iterator(q);
+        while (iter) {
+            const Set diff = Set_difference(&key.lhs, &iter->key.rhs);
+            Set S = Set_union(&iter->key.lhs, &diff);
+            STATS_ADD(s_generated, 1);
+            STATS_ADD(containment_checks, 1);
+            // Test for inclusion of any already found candidate key
+            perf_region_begin(PERF_REGION_SCAN);
+            const uint8_t contained = Zdd_has_subset(z, ckeys, &S);
+            perf_region_end(PERF_REGION_SCAN);
+            if (!contained) {
+                if (control_key_found()) {
+                    break;
+                }
+                ckey = candidate_key_from_super_key(&S, q, n_attribs);
+                const zdd_t single = Zdd_singleton(z, &ckey);
+                ckeys = Zdd_union(z, ckeys, single);
+                Q_insert(&work, (q_key_t) {.lhs = ckey, .rhs = (Set) {0}});
+            } else {
+                STATS_ADD(s_rejected, 1);
+            }
+            iter = iter->next;
+        }
+    }
+    if (batch_items > 0) {
+        trace_end("work batch", batch);
+    }
+    
+    Q_free(&work);
+    return ckeys;
+}
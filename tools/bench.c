@@ -0,0 +1,365 @@
+/*
+ * Benchmark driver for func_dep. Runs a fixed corpus of generated
+ * (fdgen) and shipped (dep_in/) FD files several times per case and
+ * records median/p95 wall time, median parse and enumeration time (from
+ * --stats), keys/s and peak RSS as JSON. Given a baseline written by an
+ * earlier run, fails if a case got slower by more than a threshold.
+ *
+ */
+
+// wait4() is not part of POSIX
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RUNS 101
+#define MAX_ARGS 32
+#define OUT_LEN (1u << 16)
+// Differences below this many seconds are noise, not regressions
+#define NOISE_FLOOR 0.002
+
+typedef struct {
+    const char *name;
+    const char *fdgen_args;  // generate input with these (NULL: use file)
+    const char *file;        // shipped input
+    const char *args;        // func_dep options
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    // Exponential key family: 2^11 keys
+    {"pairs22-lo",      "-n 22 -t pairs -m 0", NULL, "-e lo"},
+    {"pairs26-reverse", "-n 26 -t pairs -m 0", NULL, "-e reverse -j 1"},
+    {"pairs26-zdd",     "-n 26 -t pairs -m 0", NULL, "-e zdd"},
+    {"pairs26-spill",   "-n 26 -t pairs -m 0", NULL, "-M 1"},
+    // Random FDs with many keys: 1330 and 4552 keys
+    {"random26-lo",     "-n 26 -m 40 -l 2-4 -r 1-2 -s 3", NULL, "-e lo"},
+    {"random26-cdcl",   "-n 26 -m 40 -l 2-4 -r 1-2 -s 3", NULL, "-e cdcl"},
+    {"random26-reverse", "-n 26 -m 50 -l 3-4 -r 1 -s 8", NULL, "-e reverse -j 1"},
+    {"random26-ranked", "-n 26 -m 300 -l geo:0.5 -r 1-3 -s 7", NULL, "-r"},
+    // Closure-bound: prime attributes of a large FD set
+    {"closure-primes",  "-n 26 -m 2000 -l geo:0.3 -r 1-3 -s 11", NULL, "-a"},
+    // Parser-bound: many FDs, keys of a cycle are found at once
+    {"parse-50k",       "-n 26 -t cycle -m 50000 -l 8-12 -r 1 -s 13", NULL,
+                        "-e reverse -j 1"},
+    // Shipped examples
+    {"book",            NULL, "dep_in/book.txt",  "-e lo"},
+    {"large",           NULL, "dep_in/large.txt", "-e lo"},
+};
+#define N_CASES (sizeof(cases) / sizeof(cases[0]))
+
+typedef struct {
+    double median;
+    double p95;
+    double parse;      // median parse phase
+    double enumerate;  // median enumeration phase
+    double keys_per_s;
+    uint64_t keys;
+    long peak_rss_kb;
+} bench_result_t;
+
+static double now_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, uint32_t n, double p) {
+    uint32_t rank = (uint32_t)(p * n + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[(rank > n ? n : rank) - 1];
+}
+
+// Split space separated words of s (modified) into argv after prefix
+static int split_args(char *s, char **argv, int argc) {
+    char *save, *word = strtok_r(s, " ", &save);
+    while (word != NULL && argc < MAX_ARGS - 2) {
+        argv[argc++] = word;
+        word = strtok_r(NULL, " ", &save);
+    }
+    return argc;
+}
+
+// Run program, collecting stdout and stderr into out; returns exit status
+static int run(char **argv, const char *stdout_path, char *out, size_t out_len,
+    struct rusage *usage) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    // Child must not inherit unwritten output
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        if (stdout_path != NULL) {
+            if (freopen(stdout_path, "w", stdout) == NULL) {
+                _exit(127);
+            }
+        } else {
+            dup2(fds[1], STDOUT_FILENO);
+        }
+        dup2(fds[1], STDERR_FILENO);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fds[0], out + len, out_len - 1 - len)) > 0) {
+        len += (size_t) n;
+        if (len == out_len - 1) {
+            len = 0;  // keep only the tail
+        }
+    }
+    out[len] = '\0';
+    close(fds[0]);
+    int status = 0;
+    if (pid < 0 || wait4(pid, &status, 0, usage) < 0) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Value following label in output (0 if missing)
+static double find_value(const char *out, const char *label) {
+    const char *at = strstr(out, label);
+    return at != NULL ? strtod(at + strlen(label), NULL) : 0.0;
+}
+
+// Write input of case to work_dir; returns path in path
+static int8_t prepare_input(const bench_case_t *c, const char *fdgen,
+    const char *work_dir, char *path, size_t path_len) {
+    if (c->fdgen_args == NULL) {
+        snprintf(path, path_len, "%s", c->file);
+        return 0;
+    }
+    snprintf(path, path_len, "%s/%s.txt", work_dir, c->name);
+    char args[256], *argv[MAX_ARGS];
+    snprintf(args, sizeof(args), "%s", c->fdgen_args);
+    argv[0] = (char *) fdgen;
+    argv[split_args(args, argv, 1)] = NULL;
+    struct rusage usage;
+    char out[256];
+    if (run(argv, path, out, sizeof(out), &usage) != 0) {
+        fprintf(stderr, "Could not generate input of %s\n", c->name);
+        return 1;
+    }
+    return 0;
+}
+
+static int8_t run_case(const bench_case_t *c, const char *func_dep,
+    const char *input, uint32_t runs, bench_result_t *r) {
+    double wall[MAX_RUNS], parse[MAX_RUNS], enumerate[MAX_RUNS];
+    static char out[OUT_LEN];
+    char args[256], *argv[MAX_ARGS];
+    uint32_t i;
+    r->peak_rss_kb = 0;
+    r->keys = 0;
+    for (i = 0; i < runs; ++i) {
+        snprintf(args, sizeof(args), "%s --stats -o /dev/null", c->args);
+        argv[0] = (char *) func_dep;
+        int argc = split_args(args, argv, 1);
+        argv[argc++] = (char *) input;
+        argv[argc] = NULL;
+        struct rusage usage;
+        const double start = now_seconds();
+        const int status = run(argv, NULL, out, sizeof(out), &usage);
+        wall[i] = now_seconds() - start;
+        if (status != 0) {
+            fprintf(stderr, "%s failed with status %d:\n%s\n", c->name, status,
+                out);
+            return 1;
+        }
+        if (usage.ru_maxrss > r->peak_rss_kb) {
+            r->peak_rss_kb = usage.ru_maxrss;
+        }
+        // Phase times from first column (wall) of --stats table
+        parse[i] = find_value(out, "  parse ");
+        enumerate[i] = find_value(out, "  enumerate ");
+        const double keys = strstr(out, "Number of prime attributes: ") ?
+            find_value(out, "Number of prime attributes: ") :
+            find_value(out, "Number of candidate keys: ");
+        r->keys = (uint64_t) keys;
+    }
+    qsort(wall, runs, sizeof(double), compare_doubles);
+    qsort(parse, runs, sizeof(double), compare_doubles);
+    qsort(enumerate, runs, sizeof(double), compare_doubles);
+    r->median = percentile(wall, runs, 0.5);
+    r->p95 = percentile(wall, runs, 0.95);
+    r->parse = percentile(parse, runs, 0.5);
+    r->enumerate = percentile(enumerate, runs, 0.5);
+    r->keys_per_s = r->enumerate > 0.0 ? (double) r->keys / r->enumerate : 0.0;
+    return 0;
+}
+
+// Median wall time of case in baseline file (negative if not found);
+// relies on one case per line as written by this program
+static double baseline_median(const char *path, const char *name) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1.0;
+    }
+    char line[1024], key[128];
+    double median = -1.0;
+    snprintf(key, sizeof(key), "{\"name\": \"%s\",", name);
+    while (fgets(line, sizeof(line), fp)) {
+        const char *at = strstr(line, key);
+        if (at != NULL) {
+            median = find_value(at, "\"median_s\": ");
+            break;
+        }
+    }
+    fclose(fp);
+    return median;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n"
+        "Options:\n"
+        "  -r, --runs <n>        runs per case (default 5)\n"
+        "  -o, --output <f>      write results as JSON to f\n"
+        "  -b, --baseline <f>    compare median wall times with results in f\n"
+        "  -t, --threshold <x>   fail if a case is slower by more than fraction\n"
+        "                        x of its baseline (default 0.10)\n"
+        "  -d, --dir <d>         directory for generated inputs (default bench_out)\n"
+        "  -f, --func-dep <p>    func_dep binary (default ./func_dep)\n"
+        "  -g, --fdgen <p>       fdgen binary (default ./fdgen)\n",
+        prog);
+}
+
+int main(int argc, char *argv[]) {
+    long runs = 5;
+    const char *output = NULL, *baseline = NULL;
+    const char *work_dir = "bench_out";
+    const char *func_dep = "./func_dep", *fdgen = "./fdgen";
+    double threshold = 0.10;
+
+    static const struct option long_options[] = {
+        {"runs",      required_argument, NULL, 'r'},
+        {"output",    required_argument, NULL, 'o'},
+        {"baseline",  required_argument, NULL, 'b'},
+        {"threshold", required_argument, NULL, 't'},
+        {"dir",       required_argument, NULL, 'd'},
+        {"func-dep",  required_argument, NULL, 'f'},
+        {"fdgen",     required_argument, NULL, 'g'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:o:b:t:d:f:g:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                runs = strtol(optarg, NULL, 10);
+                if (runs < 1 || runs > MAX_RUNS) {
+                    fprintf(stderr, "Invalid number of runs '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'b':
+                baseline = optarg;
+                break;
+            case 't':
+                threshold = strtod(optarg, NULL);
+                if (threshold < 0.0) {
+                    fprintf(stderr, "Invalid threshold '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'd':
+                work_dir = optarg;
+                break;
+            case 'f':
+                func_dep = optarg;
+                break;
+            case 'g':
+                fdgen = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (mkdir(work_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create directory '%s'!\n", work_dir);
+        exit(EXIT_FAILURE);
+    }
+    if (baseline != NULL && access(baseline, R_OK) != 0) {
+        fprintf(stderr, "No baseline at '%s', not comparing\n", baseline);
+        baseline = NULL;
+    }
+
+    bench_result_t results[N_CASES];
+    uint32_t i, n_regressions = 0;
+    printf("%-17s %10s %10s %10s %10s %12s %10s\n", "case", "median [s]",
+        "p95 [s]", "parse [s]", "enum [s]", "keys/s", "RSS [KiB]");
+    for (i = 0; i < N_CASES; ++i) {
+        char input[512];
+        bench_result_t *r = &results[i];
+        if (prepare_input(&cases[i], fdgen, work_dir, input, sizeof(input)) ||
+            run_case(&cases[i], func_dep, input, (uint32_t) runs, r)) {
+            exit(EXIT_FAILURE);
+        }
+        printf("%-17s %10.4f %10.4f %10.4f %10.4f %12.0f %10ld", cases[i].name,
+            r->median, r->p95, r->parse, r->enumerate, r->keys_per_s,
+            r->peak_rss_kb);
+        if (baseline != NULL) {
+            const double base = baseline_median(baseline, cases[i].name);
+            if (base > 0.0) {
+                const double change = (r->median - base) / base;
+                const uint8_t regressed = change > threshold &&
+                    r->median - base > NOISE_FLOOR;
+                printf("  %+6.1f%%%s", 100.0 * change,
+                    regressed ? "  REGRESSION" : "");
+                n_regressions += regressed;
+            }
+        }
+        printf("\n");
+    }
+
+    if (output != NULL) {
+        FILE *fp = fopen(output, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Could not write results to '%s'!\n", output);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(fp, "{\"runs\": %ld, \"cases\": [\n", runs);
+        for (i = 0; i < N_CASES; ++i) {
+            const bench_result_t *r = &results[i];
+            fprintf(fp, "{\"name\": \"%s\", \"median_s\": %.6f, \"p95_s\": %.6f, "
+                "\"parse_s\": %.6f, \"enumerate_s\": %.6f, \"keys\": %lu, "
+                "\"keys_per_s\": %.1f, \"peak_rss_kb\": %ld}%s\n",
+                cases[i].name, r->median, r->p95, r->parse, r->enumerate,
+                (unsigned long) r->keys, r->keys_per_s, r->peak_rss_kb,
+                i + 1 < N_CASES ? "," : "");
+        }
+        fprintf(fp, "]}\n");
+        fclose(fp);
+    }
+    if (n_regressions > 0) {
+        fprintf(stderr, "%u case(s) regressed by more than %.0f%%\n",
+            n_regressions, 100.0 * threshold);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,606 @@
+/*
+ * Differential test of func_dep engines. Generates random FD sets over
+ * few attributes, runs every engine configuration on them and compares
+ * the sorted key masks (hex output) with those of the brute-force
+ * reference engine, with and without random constraints. The weighted
+ * search is checked against the cheapest reference keys under random
+ * weights, prime attributes against the union of reference keys. A failing
+ * input is shrunk greedily (drop FDs, drop attributes of FD sides,
+ * drop attributes altogether) while the same configuration still
+ * disagrees, and is written to a file for reproduction.
+ *
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_ATTRIBS 20u
+#define MAX_FDS 64u
+#define MAX_ARGS 32
+#define MAX_KEYS (1u << 16)
+#define OUT_LEN (16u * MAX_KEYS)
+// Keys requested from the weighted search
+#define TOP_K 3
+#define MAX_WEIGHT 9
+
+// FD set under test with optional constraints on keys
+typedef struct {
+    uint8_t n;
+    uint32_t m;
+    uint32_t lhs[MAX_FDS];
+    uint32_t rhs[MAX_FDS];
+    uint32_t include;
+    uint32_t exclude;
+    uint8_t max_size;   // 0: no size constraint
+    uint32_t weights[MAX_ATTRIBS];
+} fd_case_t;
+
+// What a configuration reports and how it is checked
+#define CHECK_KEYS      0  // all keys, compared with reference keys
+#define CHECK_WEIGHTED  1  // TOP_K cheapest keys under case weights
+#define CHECK_PRIMES    2  // prime attributes, union of reference keys
+
+typedef struct {
+    const char *name;
+    const char *args;
+    uint8_t constrained;  // configuration enforces constraints itself
+    uint8_t check;
+} config_t;
+
+static const config_t configs[] = {
+    {"lo",          "-e lo",                0, CHECK_KEYS},
+    {"lo-writer",   "-e lo -W",             0, CHECK_KEYS},
+    // Tiny budget and buffers: every few keys are flushed as runs (and
+    // merged), and the work queue spills segments
+    {"spill",       "-M 0.00001 --spill-min-buffer 2", 0, CHECK_KEYS},
+    {"reverse-1",   "-e reverse -j 1",      1, CHECK_KEYS},
+    {"reverse-4",   "-e reverse -j 4",      1, CHECK_KEYS},
+    {"zdd",         "-e zdd",               0, CHECK_KEYS},
+    {"cdcl",        "-e cdcl",              0, CHECK_KEYS},
+    {"ranked",      "-r",                   1, CHECK_KEYS},
+    {"weighted",    "",                     1, CHECK_WEIGHTED},
+    {"primes-2",    "-a -j 2",              0, CHECK_PRIMES},
+};
+#define N_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+static const char *func_dep = "./func_dep";
+static char input_path[4096];
+static uint8_t verbose = 0;
+
+// splitmix64, as in fdgen
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static uint32_t rng_below(uint32_t n) {
+    return (uint32_t)(rng_next() % n);
+}
+
+// Random non-empty subset of n attributes with up to k of them
+static uint32_t random_side(uint8_t n, uint32_t k) {
+    const uint32_t size = 1 + rng_below(k);
+    uint32_t mask = 0, i;
+    for (i = 0; i < size; ++i) {
+        mask |= 1u << rng_below(n);
+    }
+    return mask;
+}
+
+static void random_case(fd_case_t *c, uint8_t max_n, uint32_t max_m,
+    uint8_t constrained) {
+    memset(c, 0, sizeof(*c));
+    c->n = (uint8_t)(1 + rng_below(max_n));
+    c->m = rng_below(max_m + 1);
+    uint32_t i;
+    for (i = 0; i < c->m; ++i) {
+        c->lhs[i] = random_side(c->n, 3);
+        c->rhs[i] = random_side(c->n, 2);
+    }
+    for (i = 0; i < c->n; ++i) {
+        c->weights[i] = 1 + rng_below(MAX_WEIGHT);
+    }
+    if (constrained) {
+        // Sparse constraints so that keys remain
+        const uint32_t all = (uint32_t)((1ull << c->n) - 1);
+        c->include = rng_below(3) == 0 ? 1u << rng_below(c->n) : 0;
+        c->exclude = rng_below(2) == 0 ?
+            (1u << rng_below(c->n)) & ~c->include & all : 0;
+        c->max_size = rng_below(2) == 0 ? (uint8_t)(1 + rng_below(c->n)) : 0;
+    }
+}
+
+static void print_side(FILE *fp, uint32_t mask) {
+    const char *sep = "";
+    while (mask) {
+        fprintf(fp, "%s%c", sep, (char)('A' + __builtin_ctz(mask)));
+        sep = ",";
+        mask &= mask - 1;
+    }
+}
+
+static int8_t write_case(const fd_case_t *c, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write '%s'\n", path);
+        return 1;
+    }
+    fprintf(fp, "%u\n", c->n);
+    uint32_t i;
+    for (i = 0; i < c->m; ++i) {
+        print_side(fp, c->lhs[i]);
+        fprintf(fp, " -> ");
+        print_side(fp, c->rhs[i]);
+        fprintf(fp, "\n");
+    }
+    return fclose(fp) != 0;
+}
+
+// Command line options for constraints of case (empty if none)
+static void constraint_args(const fd_case_t *c, char *buf, size_t len) {
+    int used = 0;
+    buf[0] = '\0';
+    const uint32_t masks[2] = {c->include, c->exclude};
+    const char *flags[2] = {"-i", "-x"};
+    uint32_t k;
+    for (k = 0; k < 2; ++k) {
+        uint32_t mask = masks[k];
+        if (mask == 0) {
+            continue;
+        }
+        used += snprintf(buf + used, len - (size_t) used, " %s ", flags[k]);
+        const char *sep = "";
+        while (mask) {
+            used += snprintf(buf + used, len - (size_t) used, "%s%c", sep,
+                (char)('A' + __builtin_ctz(mask)));
+            sep = ",";
+            mask &= mask - 1;
+        }
+    }
+    if (c->max_size > 0) {
+        snprintf(buf + used, len - (size_t) used, " -s %u", c->max_size);
+    }
+}
+
+// Command line option with weights of case, e.g. " -w A=3,B=1"
+static void weight_args(const fd_case_t *c, char *buf, size_t len) {
+    int used = snprintf(buf, len, " -t %u -w ", TOP_K);
+    uint8_t a;
+    for (a = 0; a < c->n; ++a) {
+        used += snprintf(buf + used, len - (size_t) used, "%s%c=%u",
+            a > 0 ? "," : "", (char)('A' + a), c->weights[a]);
+    }
+}
+
+static int compare_masks(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t key_weight(const fd_case_t *c, uint32_t key) {
+    uint64_t w = 0;
+    for (; key; key &= key - 1) {
+        w += c->weights[__builtin_ctz(key)];
+    }
+    return w;
+}
+
+static int compare_weights(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Run func_dep with args on input file and capture its standard output
+// in out. Returns exit status, -1 if the run failed.
+static int run_capture(const char *args, char *out) {
+    char buf[768], *argv[MAX_ARGS], *save;
+    snprintf(buf, sizeof(buf), "%s", args);
+    int argc = 0;
+    argv[argc++] = (char *) func_dep;
+    char *word = strtok_r(buf, " ", &save);
+    while (word != NULL && argc < MAX_ARGS - 2) {
+        argv[argc++] = word;
+        word = strtok_r(NULL, " ", &save);
+    }
+    argv[argc++] = input_path;
+    argv[argc] = NULL;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    // Child must not inherit unwritten output
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        if (!verbose && freopen("/dev/null", "w", stderr) == NULL) {
+            _exit(127);
+        }
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fds[0], out + len, OUT_LEN - 1 - len)) > 0) {
+        len += (size_t) n;
+    }
+    out[len] = '\0';
+    close(fds[0]);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || len == OUT_LEN - 1) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Run func_dep with args (plus hex key output) on input file; stores
+// sorted key masks. Returns exit status, -1 if the run failed.
+static int run_engine(const char *args, uint32_t *keys, uint32_t *n_keys) {
+    static char out[OUT_LEN];
+    char buf[768];
+    snprintf(buf, sizeof(buf), "%s -F hex", args);
+    const int status = run_capture(buf, out);
+    if (status < 0) {
+        return status;
+    }
+    // One "0x%08x" line per key
+    *n_keys = 0;
+    const char *line = out;
+    while (*line != '\0') {
+        char *end;
+        if (*n_keys == MAX_KEYS) {
+            return -1;
+        }
+        keys[(*n_keys)++] = (uint32_t) strtoul(line, &end, 16);
+        if (end == line || *end != '\n') {
+            return -1;  // unparseable output
+        }
+        line = end + 1;
+    }
+    qsort(keys, *n_keys, sizeof(uint32_t), compare_masks);
+    return status;
+}
+
+// Run prime attribute search; stores mask of prime attributes
+static int run_primes(const char *args, uint32_t *prime) {
+    static char out[OUT_LEN];
+    const int status = run_capture(args, out);
+    const char *line = strstr(out, "Prime attributes:");
+    if (status != 0 || line == NULL) {
+        return status != 0 ? status : -1;
+    }
+    *prime = 0;
+    for (line += strlen("Prime attributes:"); *line != '\n' && *line; ++line) {
+        if ('A' <= *line && *line <= 'Z') {
+            *prime |= 1u << (*line - 'A');
+        }
+    }
+    return 0;
+}
+
+// Check weighted search output against the TOP_K cheapest reference
+// keys: same weights in sorted order, every key a distinct reference key
+static uint8_t weighted_disagrees(const fd_case_t *c, const uint32_t *expected,
+    uint32_t n_expected, const uint32_t *actual, uint32_t n_actual,
+    char *why, size_t why_len) {
+    static uint64_t costs_expected[MAX_KEYS], costs_actual[MAX_KEYS];
+    uint32_t i, j;
+    const uint32_t want = n_expected < TOP_K ? n_expected : TOP_K;
+    if (n_actual != want) {
+        snprintf(why, why_len, "%u keys (%u expected)", n_actual, want);
+        return 1;
+    }
+    for (i = 0; i < n_expected; ++i) {
+        costs_expected[i] = key_weight(c, expected[i]);
+    }
+    qsort(costs_expected, n_expected, sizeof(uint64_t), compare_weights);
+    for (i = 0; i < n_actual; ++i) {
+        const uint32_t *hit = (const uint32_t *) bsearch(&actual[i], expected,
+            n_expected, sizeof(uint32_t), compare_masks);
+        if (hit == NULL || (i > 0 && actual[i - 1] == actual[i])) {
+            snprintf(why, why_len, "%s key 0x%08x",
+                hit == NULL ? "extra" : "duplicate", actual[i]);
+            return 1;
+        }
+        costs_actual[i] = key_weight(c, actual[i]);
+    }
+    qsort(costs_actual, n_actual, sizeof(uint64_t), compare_weights);
+    for (j = 0; j < n_actual; ++j) {
+        if (costs_actual[j] != costs_expected[j]) {
+            snprintf(why, why_len, "key %u of weight %lu (expected %lu)", j,
+                (unsigned long) costs_actual[j],
+                (unsigned long) costs_expected[j]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Check if configuration disagrees with reference on case; describes
+// difference in why
+static uint8_t disagrees(const fd_case_t *c, const config_t *cfg,
+    char *why, size_t why_len) {
+    static uint32_t expected[MAX_KEYS], actual[MAX_KEYS];
+    uint32_t n_expected, n_actual;
+    char cons[128], weights[192], args[512];
+    if (write_case(c, input_path)) {
+        exit(EXIT_FAILURE);
+    }
+    constraint_args(c, cons, sizeof(cons));
+    snprintf(args, sizeof(args), "-e brute%s", cons);
+    if (run_engine(args, expected, &n_expected) != 0) {
+        fprintf(stderr, "Reference engine failed on '%s'\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    weights[0] = '\0';
+    if (cfg->check == CHECK_WEIGHTED) {
+        weight_args(c, weights, sizeof(weights));
+    }
+    snprintf(args, sizeof(args), "%s%s%s", cfg->args, weights, cons);
+    uint32_t i = 0, j = 0;
+    if (cfg->check == CHECK_PRIMES) {
+        uint32_t prime = 0, expected_prime = 0;
+        const int status = run_primes(args, &prime);
+        if (status != 0) {
+            snprintf(why, why_len, "exit status %d", status);
+            return 1;
+        }
+        for (i = 0; i < n_expected; ++i) {
+            expected_prime |= expected[i];
+        }
+        if (prime != expected_prime) {
+            snprintf(why, why_len, "prime attributes 0x%08x (0x%08x "
+                "expected)", prime, expected_prime);
+            return 1;
+        }
+        return 0;
+    }
+    const int status = run_engine(args, actual, &n_actual);
+    if (status != 0) {
+        snprintf(why, why_len, "exit status %d", status);
+        return 1;
+    }
+    if (cfg->check == CHECK_WEIGHTED) {
+        return weighted_disagrees(c, expected, n_expected, actual, n_actual,
+            why, why_len);
+    }
+    while (i < n_expected || j < n_actual) {
+        if (j == n_actual ||
+            (i < n_expected && expected[i] < actual[j])) {
+            snprintf(why, why_len, "missing key 0x%08x (%u expected, %u "
+                "found)", expected[i], n_expected, n_actual);
+            return 1;
+        }
+        if (i == n_expected || actual[j] < expected[i]) {
+            snprintf(why, why_len, "%s key 0x%08x (%u expected, %u found)",
+                j > 0 && actual[j - 1] == actual[j] ? "duplicate" : "extra",
+                actual[j], n_expected, n_actual);
+            return 1;
+        }
+        ++i;
+        ++j;
+    }
+    return 0;
+}
+
+// Attribute mask with attribute a removed and higher ones moved down
+static uint32_t drop_attrib(uint32_t mask, uint8_t a) {
+    const uint32_t low = mask & ((1u << a) - 1);
+    return low | ((mask >> (a + 1)) << a);
+}
+
+// Shrink failing case greedily until no single step keeps it failing
+static void shrink(fd_case_t *c, const config_t *cfg) {
+    char why[128];
+    uint8_t progress = 1;
+    while (progress) {
+        progress = 0;
+        fd_case_t t;
+        uint32_t i;
+        // Remove whole FDs
+        for (i = 0; i < c->m; ) {
+            t = *c;
+            memmove(&t.lhs[i], &t.lhs[i + 1], (t.m - i - 1) * sizeof(uint32_t));
+            memmove(&t.rhs[i], &t.rhs[i + 1], (t.m - i - 1) * sizeof(uint32_t));
+            --t.m;
+            if (disagrees(&t, cfg, why, sizeof(why))) {
+                *c = t;
+                progress = 1;
+            } else {
+                ++i;
+            }
+        }
+        // Remove single attributes from FD sides (sides stay non-empty)
+        for (i = 0; i < 2 * c->m; ++i) {
+            uint32_t *side = i % 2 ? &c->rhs[i / 2] : &c->lhs[i / 2];
+            uint32_t bits = *side;
+            while (__builtin_popcount(*side) > 1 && bits) {
+                const uint32_t bit = bits & -bits;
+                bits &= bits - 1;
+                t = *c;
+                uint32_t *tside = i % 2 ? &t.rhs[i / 2] : &t.lhs[i / 2];
+                *tside &= ~bit;
+                if (disagrees(&t, cfg, why, sizeof(why))) {
+                    *c = t;
+                    progress = 1;
+                }
+            }
+        }
+        // Remove attributes altogether (FDs with an empty side go away)
+        uint8_t a;
+        for (a = 0; a < c->n && c->n > 1; ) {
+            t = *c;
+            t.m = 0;
+            for (i = 0; i < c->m; ++i) {
+                const uint32_t lhs = drop_attrib(c->lhs[i], a);
+                const uint32_t rhs = drop_attrib(c->rhs[i], a);
+                if (lhs && rhs) {
+                    t.lhs[t.m] = lhs;
+                    t.rhs[t.m++] = rhs;
+                }
+            }
+            t.include = drop_attrib(c->include, a);
+            t.exclude = drop_attrib(c->exclude, a);
+            memmove(&t.weights[a], &t.weights[a + 1],
+                (size_t)(c->n - a - 1) * sizeof(uint32_t));
+            --t.n;
+            if (t.max_size > t.n) {
+                t.max_size = t.n;
+            }
+            if (disagrees(&t, cfg, why, sizeof(why))) {
+                *c = t;
+                progress = 1;
+            } else {
+                ++a;
+            }
+        }
+        // Drop constraints
+        if (c->include || c->exclude || c->max_size) {
+            t = *c;
+            t.include = t.exclude = 0;
+            t.max_size = 0;
+            if (disagrees(&t, cfg, why, sizeof(why))) {
+                *c = t;
+                progress = 1;
+            }
+        }
+    }
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n"
+        "Options:\n"
+        "  -b, --binary <path>   func_dep binary to test (default ./func_dep)\n"
+        "  -c, --cases <k>       number of random FD sets (default 200)\n"
+        "  -n, --attribs <n>     at most n attributes (1 to 20, default 10)\n"
+        "  -m, --fds <m>         at most m FDs (default 16)\n"
+        "  -s, --seed <s>        seed of random generator (default 1)\n"
+        "  -d, --dir <dir>       directory for inputs and failing cases\n"
+        "                        (default .)\n"
+        "  -k, --keep-going      continue after first failure\n"
+        "  -v, --verbose         show stderr of func_dep\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    long n_cases = 200, max_n = 10, max_m = 16;
+    uint64_t seed = 1;
+    const char *dir = ".";
+    uint8_t keep_going = 0;
+
+    static const struct option long_options[] = {
+        {"binary",     required_argument, NULL, 'b'},
+        {"cases",      required_argument, NULL, 'c'},
+        {"attribs",    required_argument, NULL, 'n'},
+        {"fds",        required_argument, NULL, 'm'},
+        {"seed",       required_argument, NULL, 's'},
+        {"dir",        required_argument, NULL, 'd'},
+        {"keep-going", no_argument,       NULL, 'k'},
+        {"verbose",    no_argument,       NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:c:n:m:s:d:kv", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                func_dep = optarg;
+                break;
+            case 'c':
+                n_cases = strtol(optarg, NULL, 10);
+                if (n_cases <= 0) {
+                    fprintf(stderr, "Invalid number of cases '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n':
+                max_n = strtol(optarg, NULL, 10);
+                if (max_n < 1 || max_n > (long) MAX_ATTRIBS) {
+                    fprintf(stderr, "Invalid attribute count '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'm':
+                max_m = strtol(optarg, NULL, 10);
+                if (max_m < 0 || max_m > (long) MAX_FDS) {
+                    fprintf(stderr, "Invalid FD count '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            case 'k':
+                keep_going = 1;
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    snprintf(input_path, sizeof(input_path), "%s/difftest-input.txt", dir);
+    rng_state = seed;
+
+    uint32_t n_failed = 0;
+    long k;
+    for (k = 0; k < n_cases; ++k) {
+        // Every other case also runs constrained configurations
+        fd_case_t c;
+        random_case(&c, (uint8_t) max_n, (uint32_t) max_m, k % 2);
+        uint32_t e;
+        for (e = 0; e < N_CONFIGS; ++e) {
+            const uint8_t has_constraints = c.include || c.exclude ||
+                c.max_size;
+            fd_case_t run = c;
+            if (has_constraints && !configs[e].constrained) {
+                run.include = run.exclude = 0;
+                run.max_size = 0;
+            }
+            char why[128];
+            if (!disagrees(&run, &configs[e], why, sizeof(why))) {
+                continue;
+            }
+            ++n_failed;
+            shrink(&run, &configs[e]);
+            disagrees(&run, &configs[e], why, sizeof(why));
+            char path[4096], cons[128], weights[192];
+            snprintf(path, sizeof(path), "%s/difftest-fail-%lu.txt", dir,
+                (unsigned long) n_failed);
+            if (write_case(&run, path)) {
+                exit(EXIT_FAILURE);
+            }
+            constraint_args(&run, cons, sizeof(cons));
+            weights[0] = '\0';
+            if (configs[e].check == CHECK_WEIGHTED) {
+                weight_args(&run, weights, sizeof(weights));
+            }
+            printf("FAIL case %ld, %s: %s\n  reproduce: %s %s%s%s %s\n",
+                k, configs[e].name, why, func_dep, configs[e].args, weights,
+                cons, path);
+            if (!keep_going) {
+                remove(input_path);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    remove(input_path);
+    printf("%ld cases, %u engine configurations: %u failures\n", n_cases,
+        (unsigned) N_CONFIGS, n_failed);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+/*
+ * Generates functional dependency files in the input format of
+ * func_dep. Output depends only on the parameters and the seed.
+ *
+ * Structures (added before the random FDs):
+ * - chain:  A -> B, B -> C, ...
+ * - cycle:  chain closed by last attribute -> A (every attribute is a key)
+ * - clique: every attribute of the first k determines all others of them
+ * - pairs:  A <-> B, C <-> D, ... (2^(n/2) candidate keys)
+ *
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "set.h"
+
+// Distribution of FD side sizes
+typedef struct {
+    enum { DIST_UNIFORM, DIST_GEOMETRIC } kind;
+    uint32_t min;
+    uint32_t max;
+    double p;  // success probability of geometric distribution
+} size_dist_t;
+
+// splitmix64: small, fast and identical on every platform
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform integer in [0, n)
+static uint32_t rng_below(uint32_t n) {
+    return (uint32_t)(rng_next() % n);
+}
+
+static double rng_unit(void) {
+    return (double)(rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Parse unsigned decimal number spanning all of arg; returns 0 on
+// success
+static int8_t parse_number(const char *arg, uint64_t *out) {
+    char *end;
+    if (!isdigit((unsigned char) arg[0])) {
+        return 1;  // strtoull would accept sign and blanks
+    }
+    errno = 0;
+    *out = strtoull(arg, &end, 10);
+    return *end != '\0' || errno != 0;
+}
+
+// Parse "k", "a-b" or "geo:p"; returns 0 on success
+static int8_t parse_dist(const char *arg, size_dist_t *d) {
+    char *end;
+    if (strncmp(arg, "geo:", 4) == 0) {
+        d->kind = DIST_GEOMETRIC;
+        d->p = strtod(arg + 4, &end);
+        d->min = 1;
+        d->max = MAX_ATTRIBS;
+        return *end != '\0' || d->p <= 0.0 || d->p > 1.0;
+    }
+    d->kind = DIST_UNIFORM;
+    d->min = (uint32_t) strtoul(arg, &end, 10);
+    d->max = d->min;
+    if (*end == '-') {
+        d->max = (uint32_t) strtoul(end + 1, &end, 10);
+    }
+    return *end != '\0' || d->min == 0 || d->max < d->min;
+}
+
+static uint32_t sample_size(const size_dist_t *d, uint32_t limit) {
+    uint32_t k;
+    if (d->kind == DIST_GEOMETRIC) {
+        k = 1;
+        while (k < limit && rng_unit() >= d->p) {
+            ++k;
+        }
+    } else {
+        k = d->min + rng_below(d->max - d->min + 1);
+    }
+    return k < limit ? k : limit;
+}
+
+// Random subset of k attributes out of those in pool
+static uint32_t sample_attribs(uint32_t pool, uint32_t k) {
+    uint32_t set = 0;
+    uint32_t left = (uint32_t) __builtin_popcount(pool);
+    for (; k > 0 && left > 0; --k, --left) {
+        // Pick r-th remaining attribute of pool
+        uint32_t r = rng_below(left), bits = pool;
+        while (r-- > 0) {
+            bits &= bits - 1;
+        }
+        const uint32_t bit = bits & -bits;
+        set |= bit;
+        pool &= ~bit;
+    }
+    return set;
+}
+
+static void print_side(uint32_t set) {
+    const char *sep = "";
+    while (set) {
+        printf("%s%c", sep, (char)('A' + __builtin_ctz(set)));
+        sep = ", ";
+        set &= set - 1;
+    }
+}
+
+static void print_fd(uint32_t lhs, uint32_t rhs) {
+    print_side(lhs);
+    printf(" -> ");
+    print_side(rhs);
+    printf("\n");
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n"
+        "Options:\n"
+        "  -n, --attribs <n>     number of attributes (1 to 26, default 10)\n"
+        "  -m, --fds <m>         number of random FDs (default 10)\n"
+        "  -l, --lhs <dist>      left-hand side size: k, a-b (uniform) or geo:p\n"
+        "                        (geometric from 1, success probability p);\n"
+        "                        default 1-3\n"
+        "  -r, --rhs <dist>      right-hand side size, as for --lhs (default 1-2)\n"
+        "  -t, --structure <s>   add FDs of structure: chain, cycle, clique or\n"
+        "                        pairs (hard family with 2^(n/2) keys)\n"
+        "  -k, --clique <k>      number of attributes in clique (default n)\n"
+        "  -s, --seed <s>        seed of random generator (default 1)\n",
+        prog);
+}
+
+int main(int argc, char *argv[]) {
+    long n = 10, m = 10, clique = 0;
+    uint64_t seed = 1, value;
+    size_dist_t lhs_dist = {DIST_UNIFORM, 1, 3, 0.0};
+    size_dist_t rhs_dist = {DIST_UNIFORM, 1, 2, 0.0};
+    enum { NONE, CHAIN, CYCLE, CLIQUE, PAIRS } structure = NONE;
+
+    static const struct option long_options[] = {
+        {"attribs",   required_argument, NULL, 'n'},
+        {"fds",       required_argument, NULL, 'm'},
+        {"lhs",       required_argument, NULL, 'l'},
+        {"rhs",       required_argument, NULL, 'r'},
+        {"structure", required_argument, NULL, 't'},
+        {"clique",    required_argument, NULL, 'k'},
+        {"seed",      required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:m:l:r:t:k:s:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                if (parse_number(optarg, &value) || value < 1 ||
+                    value > MAX_ATTRIBS) {
+                    fprintf(stderr, "Invalid attribute count '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                n = (long) value;
+                break;
+            case 'm':
+                if (parse_number(optarg, &value) || value > LONG_MAX) {
+                    fprintf(stderr, "Invalid FD count '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                m = (long) value;
+                break;
+            case 'l':
+            case 'r':
+                if (parse_dist(optarg, opt == 'l' ? &lhs_dist : &rhs_dist)) {
+                    fprintf(stderr, "Invalid size distribution '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                if (strcmp(optarg, "chain") == 0) {
+                    structure = CHAIN;
+                } else if (strcmp(optarg, "cycle") == 0) {
+                    structure = CYCLE;
+                } else if (strcmp(optarg, "clique") == 0) {
+                    structure = CLIQUE;
+                } else if (strcmp(optarg, "pairs") == 0) {
+                    structure = PAIRS;
+                } else {
+                    fprintf(stderr, "Unknown structure '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'k':
+                if (parse_number(optarg, &value) || value < 1) {
+                    fprintf(stderr, "Invalid clique size '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                clique = (long)(value < MAX_ATTRIBS ? value : MAX_ATTRIBS);
+                break;
+            case 's':
+                if (parse_number(optarg, &seed)) {
+                    fprintf(stderr, "Invalid seed '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (clique == 0 || clique > n) {
+        clique = n;
+    }
+    rng_state = seed;
+
+    const uint32_t all = (uint32_t)((1ull << n) - 1);
+    long i, j;
+    printf("%ld\n", n);
+    switch (structure) {
+        case CHAIN:
+        case CYCLE:
+            for (i = 0; i + 1 < n; ++i) {
+                print_fd(1u << i, 1u << (i + 1));
+            }
+            if (structure == CYCLE && n > 1) {
+                print_fd(1u << (n - 1), 1u);
+            }
+            break;
+        case CLIQUE:
+            for (i = 0; i < clique; ++i) {
+                const uint32_t others = (uint32_t)((1ull << clique) - 1) &
+                                        ~(1u << i);
+                if (others) {
+                    print_fd(1u << i, others);
+                }
+            }
+            break;
+        case PAIRS:
+            for (i = 0; i + 1 < n; i += 2) {
+                print_fd(1u << i, 1u << (i + 1));
+                print_fd(1u << (i + 1), 1u << i);
+            }
+            break;
+        default:
+            break;
+    }
+    for (j = 0; j < m && n > 1; ++j) {
+        // Right-hand side only from attributes not on the left
+        const uint32_t lhs = sample_attribs(all,
+            sample_size(&lhs_dist, (uint32_t) n - 1));
+        const uint32_t rhs = sample_attribs(all & ~lhs,
+            sample_size(&rhs_dist, (uint32_t) n - (uint32_t) __builtin_popcount(lhs)));
+        print_fd(lhs, rhs);
+    }
+
+    return EXIT_SUCCESS;
+}
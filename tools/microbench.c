@@ -0,0 +1,183 @@
+/*
+ * Microbenchmarks of Set primitives and closure kernels, linked against
+ * the same objects as func_dep. Every kernel runs over a pool of random
+ * inputs so calls cannot be folded away; the best of several repetitions
+ * is reported in ns per call.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "set.h"
+#include "queue.h"
+#include "fd.h"
+
+#define POOL 1024u
+#define REPEAT 5
+
+// Consumed results, keeps compiler from dropping calls
+static volatile uint32_t sink;
+
+static uint64_t rng_state = 1;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return 1e9 * (double) t.tv_sec + (double) t.tv_nsec;
+}
+
+static Set random_set(uint8_t n_attribs, uint8_t max_size) {
+    Set s;
+    Set_init(&s);
+    const uint8_t k = (uint8_t)(1 + rng_next() % max_size);
+    while (s.size < k) {
+        Set_insert(&s, (uint8_t)(rng_next() % n_attribs));
+    }
+    return s;
+}
+
+static Set pool_a[POOL], pool_b[POOL];
+
+static void fill_pools(uint8_t n_attribs, uint8_t max_size) {
+    uint32_t i;
+    for (i = 0; i < POOL; ++i) {
+        pool_a[i] = random_set(n_attribs, max_size);
+        pool_b[i] = random_set(n_attribs, max_size);
+    }
+}
+
+// Best time per call over REPEAT runs of iters calls of kernel
+#define MEASURE(label, iters, body) do {                               \
+    double best = 1e300;                                               \
+    int rep;                                                           \
+    for (rep = 0; rep < REPEAT; ++rep) {                               \
+        uint32_t acc = 0;                                              \
+        const double start = now_ns();                                 \
+        uint64_t it;                                                   \
+        for (it = 0; it < (iters); ++it) {                             \
+            const uint32_t i = (uint32_t)(it % POOL);                  \
+            body;                                                      \
+        }                                                              \
+        const double per_call = (now_ns() - start) / (double)(iters);  \
+        sink = acc;                                                    \
+        if (per_call < best) {                                         \
+            best = per_call;                                           \
+        }                                                              \
+    }                                                                  \
+    printf("  %-34s %10.2f ns/op\n", label, best);                     \
+} while (0)
+
+static void bench_set(uint64_t iters) {
+    printf("Set primitives (26 attributes, sets of 1-13):\n");
+    fill_pools(MAX_ATTRIBS, 13);
+    MEASURE("Set_union", iters, {
+        const Set u = Set_union(&pool_a[i], &pool_b[i]);
+        acc += u.set + u.size;
+    });
+    MEASURE("Set_intersection", iters, {
+        const Set u = Set_intersection(&pool_a[i], &pool_b[i]);
+        acc += u.set + u.size;
+    });
+    MEASURE("Set_difference", iters, {
+        const Set u = Set_difference(&pool_a[i], &pool_b[i]);
+        acc += u.set + u.size;
+    });
+    MEASURE("Set_contains", iters, {
+        acc += Set_contains(&pool_a[i], &pool_b[i]);
+    });
+    MEASURE("Set_insert + Set_remove", iters, {
+        Set s = pool_a[i];
+        const uint8_t a = (uint8_t)(pool_b[i].set % MAX_ATTRIBS);
+        if (!(s.set & (1u << a))) {
+            Set_insert(&s, a);
+            Set_remove(&s, a);
+        }
+        acc += s.set;
+    });
+    // One call per element; cursor is reset after the last one
+    MEASURE("Set_next_pos (whole set)", iters, {
+        Set s = pool_a[i];
+        uint8_t k;
+        for (k = 0; k < s.size; ++k) {
+            acc += Set_next_pos(&s);
+        }
+        acc -= s.size;
+    });
+    // Set_next_pos figure covers this many calls
+    uint64_t elements = 0;
+    uint32_t i;
+    for (i = 0; i < POOL; ++i) {
+        elements += pool_a[i].size;
+    }
+    printf("  %-34s %10.2f\n", "(mean elements per set)",
+        (double) elements / POOL);
+}
+
+// Random FDs over n_attribs attributes: lhs of 1-3, rhs of 1-2
+static void random_fds(Queue *q, uint8_t n_attribs, uint32_t n_fds) {
+    uint32_t i;
+    Q_init(q);
+    for (i = 0; i < n_fds; ++i) {
+        const Set lhs = random_set(n_attribs, 3);
+        Set rhs = random_set(n_attribs, 2);
+        rhs = Set_difference(&rhs, &lhs);
+        if (rhs.size == 0) {
+            rhs = random_set(n_attribs, 1);
+        }
+        Q_insert(q, (q_key_t) {.lhs = lhs, .rhs = rhs});
+    }
+}
+
+static void bench_closure(uint64_t iters) {
+    static const uint8_t widths[] = {8, 16, 26};
+    static const uint32_t fd_counts[] = {16, 64, 256, 1024};
+    uint32_t w, f;
+    printf("Closure kernels (random FDs, lhs 1-3, rhs 1-2; start sets of "
+        "1-4):\n");
+    for (w = 0; w < sizeof(widths); ++w) {
+        for (f = 0; f < sizeof(fd_counts) / sizeof(fd_counts[0]); ++f) {
+            const uint8_t n = widths[w];
+            Queue q;
+            random_fds(&q, n, fd_counts[f]);
+            fill_pools(n, 4);
+            // Fewer calls for larger FD sets to bound run time
+            const uint64_t calls = iters / fd_counts[f] + POOL;
+            char label[64];
+            snprintf(label, sizeof(label), "compute_closure n=%u fds=%u", n,
+                fd_counts[f]);
+            MEASURE(label, calls, {
+                const Set c = compute_closure(&pool_a[i], &q, n);
+                acc += c.set;
+            });
+            snprintf(label, sizeof(label), "is_superkey     n=%u fds=%u", n,
+                fd_counts[f]);
+            MEASURE(label, calls, {
+                acc += is_superkey(&pool_a[i], &q, n);
+            });
+            Q_free(&q);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Optional scale of iteration counts, e.g. 0.1 for a quick run
+    const double scale = argc > 1 ? strtod(argv[1], NULL) : 1.0;
+    if (scale <= 0.0) {
+        fprintf(stderr, "Usage: %s [scale]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bench_set((uint64_t)(2e7 * scale));
+    bench_closure((uint64_t)(2e8 * scale));
+    return EXIT_SUCCESS;
+}